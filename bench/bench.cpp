@@ -0,0 +1,289 @@
+// Benchmarks FM1, FM2, FM2 in doubles, LP0 and the redundancy removal on
+// input files and on seeded random polyhedra. Every (input, engine) run
+// happens in a forked child, so that its peak memory can be read from
+// getrusage, and is reported as one JSON object per line on the standard
+// output.
+
+#include <utvpi_oa_float.h>
+#include <utvpi_oa_fm.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using System = fm::System<fm::Integer>;
+
+namespace {
+
+const char *const kEngines[] = {"fm1", "fm2", "fm-float", "lp",
+                                 "redundancy"};
+
+struct Generator {
+  unsigned vars = 6;
+  unsigned rows = 16;
+  // Probability of a nonzero coefficient
+  double density = 0.5;
+  // Coefficients are drawn from [-range, range]
+  int range = 5;
+  uint64_t seed = 1;
+};
+
+// Random system whose rows all hold at the origin. Every row gets at least
+// one nonzero coefficient, and its constant is at most 0.
+void generate(const Generator &g, uint64_t seed, System &system) {
+  std::mt19937_64 rng(seed);
+  std::uniform_int_distribution<int> coef(1, g.range);
+  std::uniform_int_distribution<unsigned> column(0, g.vars - 1);
+  std::bernoulli_distribution present(g.density), negative(0.5);
+  system.beginInput(g.rows, g.vars);
+  for (unsigned i = 0; i < g.rows; i++) {
+    fm::Integer *row = system.lines.appendRow();
+    bool any = false;
+    for (unsigned k = 0; k < g.vars; k++) {
+      if (!present(rng)) continue;
+      row[k] = negative(rng) ? -coef(rng) : coef(rng);
+      any = true;
+    }
+    if (!any) row[column(rng)] = negative(rng) ? -1 : 1;
+    row[g.vars] = -coef(rng) + 1;
+    fm::normalizeRow(row, g.vars + 1);
+  }
+  system.endInput();
+}
+
+// Reads a file in the format given by its extension: .ine for cddlib, .bin
+// for the binary format and FMLib otherwise
+bool load(const std::string &path, System &system) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  fm::InputBuffer buffer(fd);
+  close(fd);
+  auto endsWith = [&](const char *suffix) {
+    size_t n = std::strlen(suffix);
+    return path.size() >= n && path.compare(path.size() - n, n, suffix) == 0;
+  };
+  if (endsWith(".bin")) {
+    const char *pos = buffer.begin();
+    return system.readBinary(pos, buffer.end());
+  }
+  fm::TextScanner text(buffer.begin(), buffer.end());
+  return endsWith(".ine") ? system.readCdd(text) : system.read(text);
+}
+
+struct Input {
+  std::string name;
+  std::string path;  // empty for a generated system
+  uint64_t seed = 0;
+};
+
+// What a child sends back to the parent
+struct Report {
+  int status = 0;  // 0 ok, 1 infeasible, 2 bad input
+  unsigned vars = 0, rows = 0, resultRows = 0;
+  double seconds = 0;
+  fm::Stats stats;
+};
+
+Report runEngine(const Input &input, const Generator &g, const char *engine,
+                 unsigned nThreads) {
+  Report report;
+  System system;
+  if (input.path.empty()) {
+    generate(g, input.seed, system);
+  } else if (!load(input.path, system)) {
+    report.status = 2;
+    return report;
+  }
+  report.vars = system.nVars;
+  report.rows = system.nLines;
+
+  fm::ThreadPool pool(nThreads);
+  bool redundancy = std::strcmp(engine, "redundancy") == 0;
+  // The engines run on the reduced system, as in the command line tool
+  if (!redundancy) system.removeRedundantConstraints(pool);
+  fm::resetStats();
+
+  System result;
+  result.varLabels = system.varLabels;
+  result.nVars = system.nVars;
+  fm::ProjectionCache<System> cache(System::kProjectionCacheBytes);
+  auto start = std::chrono::steady_clock::now();
+  bool ok = true;
+  if (redundancy) {
+    system.removeRedundantConstraints(pool);
+  } else if (std::strcmp(engine, "fm-float") == 0) {
+    ok = fm::findFloatFMOA(system, result, pool);
+  } else if (std::strcmp(engine, "lp") == 0) {
+    ok = System::findLPOA(system, result,
+                          fm::solverFactory<fm::Integer, fm::SimplexSolver>(),
+                          pool);
+  } else {
+    bool fm2 = std::strcmp(engine, "fm2") == 0;
+    ok = system.findFMOA(result, pool, cache, fm2, System::duffinCost);
+  }
+  report.seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  report.status = ok ? 0 : 1;
+  report.resultRows = redundancy ? system.nLines : result.lines.size();
+  report.stats = fm::statsSnapshot();
+  return report;
+}
+
+std::string quote(const std::string &s) {
+  std::string out = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') out.push_back('\\');
+    out.push_back(c);
+  }
+  return out + "\"";
+}
+
+// Runs one engine on one input in a child and prints its JSON record
+void measure(const Input &input, const Generator &g, const char *engine,
+             unsigned nThreads, unsigned timeout) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    perror("pipe");
+    std::exit(1);
+  }
+  std::cout.flush();
+  pid_t pid = fork();
+  if (pid < 0) {
+    perror("fork");
+    std::exit(1);
+  }
+  if (pid == 0) {
+    close(fds[0]);
+    if (timeout > 0) alarm(timeout);
+    Report report = runEngine(input, g, engine, nThreads);
+    ssize_t n = write(fds[1], &report, sizeof(report));
+    _exit(n == ssize_t(sizeof(report)) ? 0 : 1);
+  }
+  close(fds[1]);
+  Report report;
+  bool received = read(fds[0], &report, sizeof(report)) == sizeof(report);
+  close(fds[0]);
+  int st;
+  struct rusage usage;
+  wait4(pid, &st, 0, &usage);
+
+  const char *status = "ok";
+  if (!received) {
+    status = WIFSIGNALED(st) && WTERMSIG(st) == SIGALRM ? "timeout" : "error";
+  } else if (report.status == 1) {
+    status = "infeasible";
+  } else if (report.status == 2) {
+    status = "bad input";
+  }
+  std::ostringstream out;
+  out << "{\"input\": " << quote(input.name) << ", \"engine\": \"" << engine
+      << "\", \"threads\": " << nThreads << ", \"status\": \"" << status
+      << "\", \"peak_rss_kb\": " << usage.ru_maxrss;
+  if (received && report.status != 2) {
+    out << ", \"vars\": " << report.vars << ", \"rows\": " << report.rows
+        << ", \"wall_seconds\": " << report.seconds
+        << ", \"result_rows\": " << report.resultRows << ", \"stats\": ";
+    report.stats.writeJson(out);
+  }
+  out << "}";
+  std::cout << out.str() << std::endl;
+}
+
+void usage(const char *name) {
+  std::cerr
+      << "Usage: " << name << " [options] [files...]\n"
+      << "  --engines=E,...  engines to run among fm1, fm2, fm-float, lp,\n"
+      << "                   redundancy (default all)\n"
+      << "  --random=N       also run N random systems (default 0)\n"
+      << "  --vars=V         variables of a random system (default 6)\n"
+      << "  --rows=R         rows of a random system (default 16)\n"
+      << "  --density=D      probability of a nonzero coefficient"
+      << " (default 0.5)\n"
+      << "  --range=C        coefficients within [-C, C] (default 5)\n"
+      << "  --seed=S         seed of the first random system, the next ones\n"
+      << "                   use S + 1, S + 2, ... (default 1)\n"
+      << "  --timeout=S      seconds allowed per run, 0 for no limit"
+      << " (default 0)\n"
+      << "  -j N             threads per run, 0 for one per core (default 1)\n";
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Generator g;
+  std::vector<const char *> engines(std::begin(kEngines), std::end(kEngines));
+  std::vector<Input> inputs;
+  unsigned nRandom = 0, nThreads = 1, timeout = 0;
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    auto value = [&](const char *prefix) -> const char * {
+      size_t n = std::strlen(prefix);
+      return std::strncmp(arg, prefix, n) == 0 ? arg + n : nullptr;
+    };
+    const char *v;
+    if ((v = value("--engines="))) {
+      engines.clear();
+      std::string list(v);
+      std::stringstream ss(list);
+      std::string name;
+      while (std::getline(ss, name, ',')) {
+        auto it = std::find_if(std::begin(kEngines), std::end(kEngines),
+                               [&](const char *e) { return name == e; });
+        if (it == std::end(kEngines)) {
+          usage(argv[0]);
+          return 1;
+        }
+        engines.push_back(*it);
+      }
+    } else if ((v = value("--random="))) {
+      nRandom = std::strtoul(v, nullptr, 10);
+    } else if ((v = value("--vars="))) {
+      g.vars = std::max(1ul, std::strtoul(v, nullptr, 10));
+    } else if ((v = value("--rows="))) {
+      g.rows = std::strtoul(v, nullptr, 10);
+    } else if ((v = value("--density="))) {
+      g.density = std::strtod(v, nullptr);
+    } else if ((v = value("--range="))) {
+      g.range = std::max(1l, std::strtol(v, nullptr, 10));
+    } else if ((v = value("--seed="))) {
+      g.seed = std::strtoull(v, nullptr, 10);
+    } else if ((v = value("--timeout="))) {
+      timeout = std::strtoul(v, nullptr, 10);
+    } else if (std::strcmp(arg, "-j") == 0 && i + 1 < argc) {
+      nThreads = std::strtoul(argv[++i], nullptr, 10);
+      if (nThreads == 0) nThreads = std::thread::hardware_concurrency();
+    } else if (arg[0] == '-') {
+      usage(argv[0]);
+      return 1;
+    } else {
+      inputs.push_back({arg, arg, 0});
+    }
+  }
+  for (unsigned r = 0; r < nRandom; r++) {
+    std::ostringstream name;
+    name << "random:vars=" << g.vars << ",rows=" << g.rows
+         << ",density=" << g.density << ",range=" << g.range
+         << ",seed=" << g.seed + r;
+    inputs.push_back({name.str(), "", g.seed + r});
+  }
+
+  for (const Input &input : inputs) {
+    for (const char *engine : engines) {
+      measure(input, g, engine, nThreads, timeout);
+    }
+  }
+  return 0;
+}
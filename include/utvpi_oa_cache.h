@@ -0,0 +1,113 @@
+#if !defined(UTVPI_OA_CACHE_H)
+#define UTVPI_OA_CACHE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace fm {
+
+// Bitset over the variables of the input system
+using VarSet = std::vector<uint64_t>;
+
+struct VarSetHash {
+  size_t operator()(const VarSet &set) const {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (uint64_t w : set) {
+      h ^= w;
+      h *= 0x100000001b3ull;
+    }
+    return h;
+  }
+};
+
+/**
+ * Thread-safe LRU cache of projections, keyed by the set of variables that
+ * survive the eliminations
+ *
+ * Entries are shared pointers, so an entry evicted while some task still
+ * works on it stays alive until that task is done. The size of every entry is
+ * given by the caller, and the least recently used entries are evicted
+ * whenever the total exceeds the cap.
+ */
+template <class S>
+class ProjectionCache {
+ public:
+  explicit ProjectionCache(size_t maxBytes) : maxBytes_(maxBytes) {}
+
+  std::shared_ptr<const S> get(const VarSet &key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+      misses_++;
+      return nullptr;
+    }
+    hits_++;
+    lru_.splice(lru_.begin(), lru_, it->second.pos);
+    return it->second.value;
+  }
+
+  void put(const VarSet &key, std::shared_ptr<const S> value, size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (bytes > maxBytes_ || entries_.count(key)) return;
+    lru_.push_front(key);
+    entries_.emplace(key, Entry{std::move(value), bytes, lru_.begin()});
+    bytes_ += bytes;
+    evict();
+  }
+
+  // Lowers the cap to maxBytes if it is above, evicting as needed
+  void limit(size_t maxBytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    maxBytes_ = std::min(maxBytes_, maxBytes);
+    evict();
+  }
+
+  // Total size of the entries, which may be read without the lock
+  size_t bytes() const { return bytes_.load(std::memory_order_relaxed); }
+
+  size_t hits() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hits_;
+  }
+
+  size_t misses() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return misses_;
+  }
+
+ private:
+  struct Entry {
+    std::shared_ptr<const S> value;
+    size_t bytes;
+    std::list<VarSet>::iterator pos;
+  };
+
+  size_t maxBytes_;
+  std::atomic<size_t> bytes_{0};
+  size_t hits_ = 0, misses_ = 0;
+  mutable std::mutex mutex_;
+  std::list<VarSet> lru_;
+  std::unordered_map<VarSet, Entry, VarSetHash> entries_;
+
+  // Evicts the least recently used entries until the total fits the cap
+  void evict() {
+    while (bytes_ > maxBytes_) {
+      auto victim = entries_.find(lru_.back());
+      bytes_ -= victim->second.bytes;
+      entries_.erase(victim);
+      lru_.pop_back();
+    }
+  }
+};
+
+}  // namespace fm
+
+#endif  // UTVPI_OA_CACHE_H
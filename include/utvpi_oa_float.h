@@ -0,0 +1,683 @@
+#if !defined(UTVPI_OA_FLOAT_H)
+#define UTVPI_OA_FLOAT_H
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <utvpi_oa_fm.h>
+#include <utvpi_oa_matrix.h>
+#include <utvpi_oa_simplex.h>
+#include <utvpi_oa_stats.h>
+#include <utvpi_oa_thread_pool.h>
+
+namespace fm {
+
+// Integers below this magnitude are exact in a double
+constexpr double kExactDouble = 9007199254740992.0;  // 2^53
+// Relative error of one rounding to nearest
+constexpr double kUnitRoundoff = 1.0 / kExactDouble;
+
+/**
+ * A double whose comparisons take values within a relative kTolerance of each
+ * other as equal: the value type of the floating-point simplex
+ */
+class Approx {
+ public:
+  static constexpr double kTolerance = 1e-9;
+
+  Approx(double v = 0) : v_(v) {}
+
+  double value() const { return v_; }
+
+  // A sum which cancels down to the tolerance of its terms is flushed to
+  // zero, so that the pivots do not leave noise in the tableau
+  Approx operator-() const { return Approx(-v_); }
+  Approx operator+(const Approx &other) const { return sum(v_, other.v_); }
+  Approx operator-(const Approx &other) const { return sum(v_, -other.v_); }
+  Approx operator*(const Approx &other) const { return v_ * other.v_; }
+  Approx operator/(const Approx &other) const { return v_ / other.v_; }
+  Approx reciprocal() const { return 1 / v_; }
+
+  bool operator==(const Approx &other) const {
+    return std::fabs(v_ - other.v_) <= slack(other);
+  }
+  bool operator!=(const Approx &other) const { return !(*this == other); }
+  bool operator<(const Approx &other) const {
+    return v_ < other.v_ - slack(other);
+  }
+  bool operator>(const Approx &other) const { return other < *this; }
+  bool operator<=(const Approx &other) const { return !(other < *this); }
+  bool operator>=(const Approx &other) const { return !(*this < other); }
+
+ private:
+  double v_;
+
+  double slack(const Approx &other) const {
+    return kTolerance *
+           std::max({1.0, std::fabs(v_), std::fabs(other.v_)});
+  }
+
+  static double sum(double a, double b) {
+    double s = a + b;
+    double scale = std::max(std::fabs(a), std::fabs(b));
+    return std::fabs(s) <= kTolerance * scale ? 0 : s;
+  }
+};
+
+// Thrown when a coefficient of the floating-point engine would not be an
+// exact integer, after which the system is left to the exact engine
+class FloatOverflow : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+/**
+ * Rows a * x >= c of a system in doubles, for the floating-point FM engine
+ *
+ * Every entry is an integer. The coefficients are exact, i.e. below 2^53 in
+ * magnitude, and an elimination which would break this throws FloatOverflow.
+ * A constant which is not exact is rounded down, which only makes its row
+ * weaker, and the row is marked rounded. Every row is thus implied by the
+ * exact system, and so is every bound found from them. As long as nothing is
+ * rounded and the floating-point redundancy pass drops the rows the exact one
+ * would, the rows are those exact FM would find.
+ */
+struct FloatSystem {
+  Matrix<double> lines;
+  std::vector<char> rounded;
+  // Variable of the input system in each column
+  std::vector<unsigned> vars;
+  unsigned nVars = 0;
+  // Empty unless the system was produced by removeVar
+  History history;
+
+  unsigned rows() const { return lines.size(); }
+
+  template <class T>
+  static FloatSystem convert(const System<T> &system) {
+    FloatSystem res;
+    res.nVars = system.nVars;
+    res.vars.resize(system.nVars);
+    std::iota(res.vars.begin(), res.vars.end(), 0);
+    res.lines.setCols(system.nVars + 1);
+    res.lines.reserve(system.nLines);
+    for (unsigned i = 0; i < system.nLines; i++) {
+      double *line = res.lines.appendRow();
+      for (unsigned k = 0; k < system.nVars; k++) {
+        line[k] = toDouble(system.coef(i, k));
+        if (!(std::fabs(line[k]) < kExactDouble)) {
+          throw FloatOverflow("coefficient beyond 2^53");
+        }
+      }
+      // Nearest double, one step down if that is above the constant
+      T c = system.coef(i, system.nVars);
+      double d = toDouble(c);
+      bool round = !(std::fabs(d) < kExactDouble) && T(d) != c;
+      if (round && c < T(d)) d = std::nextafter(d, -HUGE_VAL);
+      line[system.nVars] = d;
+      res.rounded.push_back(round);
+    }
+    return res;
+  }
+
+  // a * x + b * y for integers held exactly, rounded down if it is not
+  // exact. Any evaluation of it misses the exact value by at most 2u of
+  // |a * x| + |b * y|, which the margin below covers twice, so this does
+  // not depend on how the compiler contracts it.
+  static double combineDown(double a, double x, double b, double y,
+                            bool &round) {
+    double size = std::fabs(a * x) + std::fabs(b * y);
+    double v = a * x + b * y;
+    if (size < kExactDouble) return v;
+    if (!std::isfinite(v)) throw FloatOverflow("constant beyond a double");
+    round = true;
+    return std::floor(v - 4 * kUnitRoundoff * size);
+  }
+
+  // res[k] = a * x[k] + b * y[k] over the coefficients, with column var
+  // dropped. Returns false if one of them is not exact. The loop has no
+  // branch, so that it vectorizes.
+  static bool combine(double a, const double *x, double b, const double *y,
+                      double *res, unsigned var, unsigned n) {
+    int over = 0;
+    for (unsigned k = 0; k < var; k++) {
+      double u = a * x[k], w = b * y[k];
+      res[k] = u + w;
+      over |= std::fabs(u) + std::fabs(w) >= kExactDouble;
+    }
+    for (unsigned k = var + 1; k < n; k++) {
+      double u = a * x[k], w = b * y[k];
+      res[k - 1] = u + w;
+      over |= std::fabs(u) + std::fabs(w) >= kExactDouble;
+    }
+    return !over;
+  }
+
+  // Divides a row by the gcd of its coefficients, and of its constant when
+  // that is exact. A constant which the gcd does not divide is rounded down.
+  static void normalize(double *line, unsigned n, bool &round) {
+    int64_t g = 0;
+    for (unsigned k = 0; k < n; k++) {
+      if (line[k] != 0) g = std::gcd(g, int64_t(line[k]));
+    }
+    double &c = line[n];
+    bool exact = std::fabs(c) < kExactDouble;
+    if (exact && c != 0) g = std::gcd(g, int64_t(c));
+    if (g <= 1) return;
+    for (unsigned k = 0; k < n; k++) line[k] /= g;
+    if (std::fmod(c, double(g)) == 0) {
+      c /= g;
+    } else {
+      double q = c / g;
+      c = std::floor(q - 2 * kUnitRoundoff * std::fabs(q));
+      round = true;
+    }
+  }
+
+  // Same eliminations as System::removeVar, with the same history criteria
+  // and budget checks
+  FloatSystem removeVar(unsigned var, const Budget *budget = nullptr) const {
+    FloatSystem res;
+    res.nVars = nVars - 1;
+    res.vars = vars;
+    res.vars.erase(res.vars.begin() + var);
+    res.lines.setCols(nVars);
+
+    History fresh;
+    if (history.empty()) fresh = History::start(lines, nVars);
+    const History &hist = history.empty() ? fresh : history;
+    History &resHist = res.history;
+    resHist.rowWords = hist.rowWords;
+    resHist.varWords = hist.varWords;
+    resHist.rows.setCols(hist.rowWords);
+    resHist.vars.setCols(hist.varWords);
+    resHist.columns = hist.columns;
+    resHist.columns.erase(resHist.columns.begin() + var);
+    resHist.eliminated = hist.eliminated;
+    resHist.eliminated[hist.columns[var] / 64] |= uint64_t(1)
+                                                  << (hist.columns[var] % 64);
+    resHist.nEliminated = hist.nEliminated + 1;
+
+    std::vector<unsigned> pos, neg;
+    unsigned nZero = 0;
+    for (unsigned i = 0; i < rows(); i++) {
+      if (lines[i][var] > 0)
+        pos.push_back(i);
+      else if (lines[i][var] < 0)
+        neg.push_back(i);
+      else
+        nZero++;
+    }
+    // As in System::removeVar, the output grows as needed
+    res.lines.reserve(nZero + pos.size() + neg.size());
+    for (unsigned i = 0; i < rows(); i++) {
+      if (lines[i][var] != 0) continue;
+      double *dst = res.lines.appendRow();
+      for (unsigned k = 0, l = 0; k <= nVars; k++) {
+        if (k != var) dst[l++] = lines[i][k];
+      }
+      res.rounded.push_back(rounded[i]);
+      resHist.rows.pushRow(hist.rows[i]);
+      resHist.vars.pushRow(hist.vars[i]);
+    }
+
+    std::vector<uint64_t> rowSet(hist.rowWords), varSet(hist.varWords);
+    uint64_t nChernikov = 0, nImbert = 0, nRounded = 0;
+    size_t rowBytes = size_t(nVars) * sizeof(double) +
+                      size_t(hist.rowWords + hist.varWords) * 8;
+    for (unsigned i : pos) {
+      if (budget) budget->check(res.rows(), res.rows() * rowBytes);
+      for (unsigned j : neg) {
+        for (unsigned w = 0; w < hist.rowWords; w++) {
+          rowSet[w] = hist.rows[i][w] | hist.rows[j][w];
+        }
+        unsigned nOrigins = History::popcount(rowSet.data(), hist.rowWords);
+        if (nOrigins > resHist.nEliminated + 1) {
+          nChernikov++;
+          continue;
+        }
+
+        int64_t c1 = int64_t(lines[i][var]), c2 = int64_t(-lines[j][var]);
+        int64_t g = std::gcd(c1, c2);
+        double a = double(c2 / g), b = double(c1 / g);
+        double *line = res.lines.appendRow();
+        if (!combine(a, lines[i], b, lines[j], line, var, nVars)) {
+          throw FloatOverflow("coefficient beyond 2^53");
+        }
+        bool round = rounded[i] || rounded[j];
+        line[res.nVars] =
+            combineDown(a, lines[i][nVars], b, lines[j][nVars], round);
+        unsigned nPresent = 0;
+        for (unsigned k = 0; k < res.nVars; k++) {
+          if (line[k] != 0) nPresent++;
+        }
+        bool all_zeros = nPresent == 0 && line[res.nVars] == 0;
+
+        unsigned nEffective = 0, nRemaining = 0;
+        for (unsigned w = 0; w < hist.varWords; w++) {
+          varSet[w] = hist.vars[i][w] | hist.vars[j][w];
+          nEffective += __builtin_popcountll(varSet[w] & resHist.eliminated[w]);
+          nRemaining +=
+              __builtin_popcountll(varSet[w] & ~resHist.eliminated[w]);
+        }
+        unsigned nImplicit = nRemaining - nPresent;
+        if (all_zeros || nOrigins > 1 + nEffective + nImplicit) {
+          res.lines.popRow();
+          nImbert++;
+          continue;
+        }
+        normalize(line, res.nVars, round);
+        if (round && !rounded[i] && !rounded[j]) nRounded++;
+        res.rounded.push_back(round);
+        resHist.rows.pushRow(rowSet.data());
+        resHist.vars.pushRow(varSet.data());
+        if (budget && res.rows() % 16 == 0) {
+          budget->check(res.rows(), res.rows() * rowBytes);
+        }
+      }
+    }
+    if (budget) budget->check(res.rows(), res.rows() * rowBytes);
+    addStat(Counter::Eliminations);
+    addStat(Counter::Combinations, uint64_t(pos.size()) * neg.size());
+    addStat(Counter::ChernikovDrops, nChernikov);
+    addStat(Counter::ImbertDrops, nImbert);
+    addStat(Counter::RowsKept, res.rows());
+    addStat(Counter::RoundedRows, nRounded);
+    notePeakRows(res.rows());
+    return res;
+  }
+
+  // Drops the rows which the floating-point simplex finds implied by the
+  // others. Dropping rows can only enlarge the polyhedron, so a wrong
+  // verdict may loosen the bounds but never makes them unsound. Warm starts
+  // pile up rounding errors on these degenerate systems, so every row is
+  // checked on a tableau of its own, built from the rows kept so far.
+  // Beyond kFloatLPLimit the tolerance no longer tells small entries from
+  // noise, so such systems go through the exact simplex instead. As in
+  // System, an empty polyhedron is left as is, history included, so that the
+  // history criteria still prune its eliminations until the bounds show it
+  // is empty.
+  void removeRedundantConstraints(const Budget *budget = nullptr) {
+    std::vector<bool> keep(rows(), true);
+    double largest = 0;
+    for (auto line : lines) {
+      for (double v : line) largest = std::max(largest, std::fabs(v));
+    }
+    if (largest < kFloatLPLimit) {
+      Matrix<double> kept(nVars + 1);
+      kept.reserve(rows());
+      for (unsigned i = 0; i < rows(); i++) {
+        kept.clear();
+        unsigned at = 0;
+        for (unsigned j = 0; j < rows(); j++) {
+          if (j == i) at = kept.size();
+          if (keep[j]) kept.pushRow(lines[j]);
+        }
+        if (budget) budget->check();
+        Simplex<double, Approx> simplex(kept, nVars);
+        if (!simplex.feasible()) {
+          // Every row is still kept in the first tableau
+          if (i == 0) return;
+          break;
+        }
+        keep[i] = !simplex.isRedundant(at);
+      }
+    } else {
+      Matrix<Integer> exact(nVars + 1);
+      exact.reserve(rows());
+      for (auto line : lines) {
+        Integer *dst = exact.appendRow();
+        for (unsigned k = 0; k <= nVars; k++) dst[k] = Integer(line[k]);
+      }
+      Simplex<Integer> simplex(exact, nVars);
+      if (!simplex.feasible()) return;
+      for (unsigned i = 0; i < rows(); i++) {
+        if (budget) budget->check();
+        keep[i] = !simplex.removeIfRedundant(i);
+      }
+    }
+    unsigned out = 0;
+    for (unsigned i = 0; i < rows(); i++) {
+      if (keep[i]) rounded[out++] = rounded[i];
+    }
+    addStat(Counter::RedundancyChecks, rows());
+    addStat(Counter::RedundantRows, rows() - out);
+    lines.compactRows(keep);
+    rounded.resize(out);
+    history.clear();
+  }
+
+  static constexpr double kFloatLPLimit = double(1 << 26);
+
+  // As System::project, the LP pass only runs when the system grew
+  FloatSystem project(unsigned var, const Budget *budget = nullptr) const {
+    FloatSystem res = removeVar(var, budget);
+    if (res.rows() > rows()) res.removeRedundantConstraints(budget);
+    return res;
+  }
+
+  // Duffin's growth estimate, as System::duffinCost
+  double duffinCost(unsigned var) const {
+    double p = 0, n = 0;
+    for (unsigned i = 0; i < rows(); i++) {
+      if (lines[i][var] > 0)
+        p++;
+      else if (lines[i][var] < 0)
+        n++;
+    }
+    return p * n - (p + n);
+  }
+};
+
+/**
+ * FM2 in doubles
+ *
+ * The pairs are projected out on the pair tree of System::vanillaFMOA, with
+ * FloatSystem rows and the floating-point simplex for the redundancy pass.
+ * A bound found from a rounded row is still sound but may be loose, and with
+ * tighten it is minimized again with the exact simplex. The subtrees which
+ * run over the budget are bounded with LP0 on the exact system, as in FM2.
+ */
+template <class T>
+class FloatFM {
+ public:
+  FloatFM(const System<T> &system, ThreadPool &pool, bool tighten,
+          const Budget *budget = nullptr)
+      : system_(system),
+        pool_(pool),
+        tighten_(tighten),
+        budget_(budget),
+        n_(system.nVars),
+        slots_(n_ * n_),
+        ok_(n_ * n_, true),
+        fallback_(pool.size()) {}
+
+  // Appends the bounds in the order of vanillaFMOA. Returns false if the
+  // system is infeasible, and throws FloatOverflow if the rows do not fit
+  // in doubles, in which case result is left as it was.
+  bool run(System<T> &result) {
+    pairsWithin(FloatSystem::convert(system_));
+    for (unsigned i = 0; i < n_; i++) {
+      for (unsigned j = i + 1; j < n_; j++) {
+        if (!ok_[i * n_ + j]) return false;
+      }
+    }
+    // Only the double-precision pass found the system feasible and the
+    // rounded bounds bounded, so the exact simplex checks both. A bound it
+    // cannot minimize keeps its rounded value, which is still sound.
+    std::unique_ptr<Simplex<T>> exact;
+    if (tighten_ && anyRounded()) {
+      Matrix<T> scratch;
+      exact.reset(new Simplex<T>(system_.denseLines(scratch), system_.nVars));
+      if (!exact->feasible()) return false;
+    }
+    for (unsigned i = 0; i < n_; i++) {
+      for (unsigned j = i + 1; j < n_; j++) {
+        for (Bound &b : slots_[i * n_ + j]) {
+          if (b.rounded && exact) {
+            Rational<T> value;
+            if (exact->minimize(b.dir, value)) b.value = value;
+            addStat(Counter::LPSolves);
+          }
+          result.addBound(b.dir, b.value);
+        }
+      }
+    }
+    result.nLines = result.lines.size();
+    return true;
+  }
+
+ private:
+  struct Bound {
+    std::vector<std::pair<unsigned, int>> dir;
+    Rational<T> value;
+    bool rounded;
+  };
+
+  using PairRange = typename System<T>::PairRange;
+
+  const System<T> &system_;
+  ThreadPool &pool_;
+  bool tighten_;
+  const Budget *budget_;
+  unsigned n_;
+  // Bounds of every pair (i, j), at i * n + j
+  std::vector<std::vector<Bound>> slots_;
+  std::vector<char> ok_;
+  // Exact tableaus of the budget fallback, one per worker
+  std::vector<std::unique_ptr<Simplex<T>>> fallback_;
+
+  bool anyRounded() const {
+    for (auto &bounds : slots_) {
+      for (const Bound &b : bounds) {
+        if (b.rounded) return true;
+      }
+    }
+    return false;
+  }
+
+  // Eliminates the variables in columns [begin, end), cheapest first
+  FloatSystem projectOut(const FloatSystem &system, unsigned begin,
+                         unsigned end) const {
+    assert(begin < end);
+    FloatSystem res = system;
+    for (; end > begin; end--) {
+      unsigned best = begin;
+      double bestCost = res.duffinCost(begin);
+      for (unsigned c = begin + 1; c < end; c++) {
+        double cost = res.duffinCost(c);
+        if (cost < bestCost) {
+          best = c;
+          bestCost = cost;
+        }
+      }
+      res = res.project(best, budget_);
+    }
+    return res;
+  }
+
+  void pairsWithin(const FloatSystem &system) {
+    unsigned m = system.nVars;
+    if (m < 2) return;
+    if (m == 2) {
+      pairBounds(system);
+      return;
+    }
+    unsigned h = m / 2;
+    TaskGroup group(pool_);
+    group.run([&] {
+      guarded(system, {0, h, 0, h},
+              [&] { pairsWithin(projectOut(system, h, m)); });
+    });
+    group.run([&] {
+      guarded(system, {h, m, h, m},
+              [&] { pairsWithin(projectOut(system, 0, h)); });
+    });
+    pairsAcross(system, h);
+    group.wait();
+  }
+
+  void pairsAcross(const FloatSystem &system, unsigned h) {
+    unsigned m = system.nVars;
+    if (m == 2) {
+      pairBounds(system);
+      return;
+    }
+    TaskGroup group(pool_);
+    if (h >= m - h) {
+      unsigned mid = h / 2;
+      group.run([&, mid] {
+        guarded(system, {0, mid, h, m},
+                [&] { pairsAcross(projectOut(system, mid, h), mid); });
+      });
+      guarded(system, {mid, h, h, m},
+              [&] { pairsAcross(projectOut(system, 0, mid), h - mid); });
+    } else {
+      unsigned mid = h + (m - h) / 2;
+      group.run([&, mid] {
+        guarded(system, {0, h, h, mid},
+                [&] { pairsAcross(projectOut(system, mid, m), h); });
+      });
+      guarded(system, {0, h, mid, m},
+              [&] { pairsAcross(projectOut(system, h, mid), h); });
+    }
+    group.wait();
+  }
+
+  // Runs the subtree which bounds the pairs of range, in the columns of
+  // system, or bounds them with LP0 on the exact system if it runs over the
+  // budget, as System::lpFallback does
+  template <class F>
+  void guarded(const FloatSystem &system, const PairRange &range, F subtree) {
+    try {
+      subtree();
+    } catch (const BudgetExceeded &) {
+      auto &tableau = fallback_[pool_.currentWorker()];
+      if (!tableau) {
+        Matrix<T> scratch;
+        tableau.reset(
+            new Simplex<T>(system_.denseLines(scratch), system_.nVars));
+      }
+      bool feasible = tableau->feasible();
+      for (unsigned a = range.a0; a < range.a1; a++) {
+        for (unsigned b = std::max(range.b0, a + 1); b < range.b1; b++) {
+          unsigned v0 = system.vars[a], v1 = system.vars[b];
+          std::vector<Bound> &out = slots_[v0 * n_ + v1];
+          out.clear();
+          ok_[v0 * n_ + v1] = feasible;
+          if (!feasible) continue;
+          Rational<T> value;
+          for (auto &dir : System<T>::pairDirections(v0, v1, n_)) {
+            if (tableau->minimize(dir, value)) {
+              out.push_back({dir, value, false});
+            }
+          }
+          addStat(Counter::BudgetFallbacks);
+        }
+      }
+    }
+  }
+
+  // The bounds System::findBounds gives the pair of a two-variable system
+  void pairBounds(const FloatSystem &system) {
+    unsigned v0 = system.vars[0], v1 = system.vars[1];
+    std::vector<Bound> &out = slots_[v0 * n_ + v1];
+    char &ok = ok_[v0 * n_ + v1];
+    if (v0 + 1 == v1) {
+      ok = ok && singleBounds(system.removeVar(1), {{v0, 1}}, {{v0, -1}}, out);
+    }
+    if (v0 == 0 && v1 + 1 == n_) {
+      ok = ok && singleBounds(system.removeVar(0), {{v1, 1}}, {{v1, -1}}, out);
+    }
+
+    // x0 + x1 and x0 - x1 as the variables, which doubles the constants
+    FloatSystem rotated = system;
+    rotated.history.clear();
+    for (unsigned i = 0; i < rotated.rows(); i++) {
+      double *line = rotated.lines[i];
+      double a0 = line[0], a1 = line[1];
+      if (!(std::fabs(a0) + std::fabs(a1) < kExactDouble)) {
+        throw FloatOverflow("coefficient beyond 2^53");
+      }
+      line[0] = a0 + a1;
+      line[1] = a0 - a1;
+      line[2] *= 2;
+      if (!std::isfinite(line[2])) {
+        throw FloatOverflow("constant beyond a double");
+      }
+    }
+    ok = ok && singleBounds(rotated.removeVar(1), {{v0, 1}, {v1, 1}},
+                            {{v0, -1}, {v1, -1}}, out);
+    ok = ok && singleBounds(rotated.removeVar(0), {{v0, 1}, {v1, -1}},
+                            {{v0, -1}, {v1, 1}}, out);
+  }
+
+  // Bounds of a one-variable system, as System::simplifySingleVar, on the
+  // directions pos (for x) and neg (for -x). The rows are integers, so the
+  // bounds are exact rationals. Returns false if the rows are infeasible.
+  bool singleBounds(const FloatSystem &system,
+                    std::vector<std::pair<unsigned, int>> pos,
+                    std::vector<std::pair<unsigned, int>> neg,
+                    std::vector<Bound> &out) {
+    assert(system.nVars == 1);
+    Bound best[2] = {{std::move(pos), Rational<T>(), false},
+                     {std::move(neg), Rational<T>(), false}};
+    bool found[2] = {false, false};
+    for (unsigned i = 0; i < system.rows(); i++) {
+      const double *line = system.lines[i];
+      if (line[0] == 0) {
+        if (line[1] > 0) return false;
+        continue;
+      }
+      unsigned s = line[0] > 0 ? 0 : 1;
+      Rational<T> val(T(line[1]), T(std::fabs(line[0])));
+      if (!found[s] || best[s].value < val ||
+          (best[s].rounded && !system.rounded[i] && !(val < best[s].value))) {
+        found[s] = true;
+        best[s].value = val;
+        best[s].rounded = system.rounded[i];
+      }
+    }
+    // x >= posMax and -x >= negMax
+    if (found[0] && found[1] && best[0].value + best[1].value > T(0)) {
+      return false;
+    }
+    for (unsigned s = 0; s < 2; s++) {
+      if (found[s]) out.push_back(std::move(best[s]));
+    }
+    return true;
+  }
+};
+
+// FM2 in doubles on a system, or exact FM2 if its rows do not fit. Both
+// bound the branches which run over the budget with LP0.
+template <class T>
+bool findFloatFMOA(const System<T> &system, System<T> &result,
+                   ThreadPool &pool, bool tighten = false,
+                   const Budget *budget = nullptr) {
+  try {
+    return FloatFM<T>(system, pool, tighten, budget).run(result);
+  } catch (const FloatOverflow &) {
+    addStat(Counter::FloatFallbacks);
+    ProjectionCache<System<T>> cache(
+        System<T>::projectionCacheBytes(budget));
+    return system.findFMOA(result, pool, cache, true, System<T>::duffinCost,
+                           budget);
+  }
+}
+
+// printFMOA with the floating-point engine, the budget covering the whole run
+template <class T>
+void printFloatFMOA(const System<T> &system, std::ostream &out,
+                    ThreadPool &pool, bool tighten = false,
+                    OAFormat format = OAFormat::Rows,
+                    Budget budget = Budget()) {
+  budget.start();
+  const Budget *limits = budget.limited() ? &budget : nullptr;
+  System<T> result;
+  result.varLabels = system.varLabels;
+  result.nVars = system.nVars;
+  bool r = system.presolvedOA(
+      result, pool,
+      [&](const System<T> &sub, System<T> &res,
+          const typename System<T>::Seeds &) {
+        return findFloatFMOA(sub, res, pool, tighten, limits);
+      });
+  if (!r) {
+    out << "Infeasible!" << std::endl;
+  } else {
+    result.printOA(out, format);
+  }
+}
+
+}  // namespace fm
+
+#endif  // UTVPI_OA_FLOAT_H
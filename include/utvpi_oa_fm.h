@@ -1,686 +1,2077 @@
 #if !defined(UTVPI_OA_FM_H)
 #define UTVPI_OA_FM_H
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cmath>
+#include <cstring>
+#include <functional>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <numeric>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
-#include <ilcplex/ilocplex.h>
+#include <utvpi_oa_cache.h>
+#include <utvpi_oa_integer.h>
+#include <utvpi_oa_io.h>
+#include <utvpi_oa_kernel.h>
+#include <utvpi_oa_lp.h>
+#include <utvpi_oa_matrix.h>
+#include <utvpi_oa_octagon.h>
+#include <utvpi_oa_rational.h>
+#include <utvpi_oa_simplex.h>
+#include <utvpi_oa_stats.h>
+#include <utvpi_oa_thread_pool.h>
 
 namespace fm {
 
+template <class T>
+struct VarBounds {
+  bool posMaxFound = false;
+  bool negMaxFound = false;
+  Rational<T> posMax;
+  Rational<T> negMax;
+};
+
+template <class T>
+void makeDenominatorsOne(std::vector<Rational<T>> &line) {
+  T l = 1;
+  for (auto &rat : line) {
+    if (rat.denominator != T(1)) l = lcm(l, rat.denominator);
+  }
+  for (auto &rat : line) {
+    if (rat.denominator == T(1) && l == T(1)) continue;
+    rat.numerator = (rat.numerator * l) / rat.denominator;
+    rat.denominator = 1;
+  }
+}
+
 /**
- * Rational number
+ * Divides a fraction-free row by its content (the gcd of all its entries)
  */
 template <class T>
-struct Rational {
-  T numerator;
-  T denominator;
-
-  Rational(T n = 0, T d = 1) {
-    numerator = n;
-    denominator = d;
-    simplify();
-  }
-
-  Rational(const Rational<T> &r) {
-    numerator = r.numerator;
-    denominator = r.denominator;
-    simplify();
-  }
-
-  void simplify() {
-    if (denominator == 0) {
-      assert(false);
-    }
-    if (numerator == 0) {
-      denominator = 1;
-    }
-    T g = std::gcd(numerator, denominator);
-    numerator /= g;
-    denominator /= g;
-  }
-
-  static Rational<T> read(std::istream &in) {
-    Rational<T> rat(0, 1);
-    std::string input;
-    in >> input;
-    auto found = input.find("/");
-    if (found != std::string::npos) {
-      std::string num = input.substr(0, found);
-      std::string den = input.substr(found + 1);
-      std::stringstream ssnum(num);
-      ssnum >> rat.numerator;
-      std::stringstream ssden(den);
-      ssden >> rat.denominator;
-    } else {
-      std::stringstream ss(input);
-      ss >> rat.numerator;
-      rat.denominator = 1;
-    }
-    return rat;
+void normalizeRow(T *line, unsigned n) {
+  T g = 0;
+  for (unsigned i = 0; i < n; i++) {
+    if (line[i] == T(0)) continue;
+    g = gcd(g, line[i]);
+    if (g == T(1)) return;
   }
-
-  void print(std::ostream &out) const {
-    out << numerator;
-    if (denominator != 1) {
-      out << "/" << denominator;
-    }
+  if (g == T(0)) return;
+  for (unsigned i = 0; i < n; i++) {
+    line[i] /= g;
   }
+}
 
-  Rational<T> operator-() const {
-    Rational<T> rat(-numerator, denominator);
-    return rat;
+/**
+ * Elimination history of the rows of a System
+ *
+ * For every row this records which rows of the origin system (the system the
+ * eliminations started from) it was combined from, and which origin variables
+ * occur in those rows. Together with the set of variables eliminated so far
+ * this is enough to apply the Chernikov and Imbert criteria, which detect
+ * redundant combinations without solving any LP.
+ */
+struct History {
+  unsigned rowWords = 0, varWords = 0;
+  // Per row bitsets over the origin rows and the origin variables
+  Matrix<uint64_t> rows, vars;
+  // Origin variable of every column
+  std::vector<unsigned> columns;
+  // Bitset of the origin variables eliminated so far, and their number
+  std::vector<uint64_t> eliminated;
+  unsigned nEliminated = 0;
+
+  bool empty() const { return rowWords == 0; }
+
+  void clear() { *this = History(); }
+
+  // History of a system used as the origin of the eliminations, stored in a
+  // Matrix or a SparseMatrix
+  template <class Rows>
+  static History start(const Rows &lines, unsigned nVars) {
+    History h;
+    h.rowWords = std::max(1u, (lines.size() + 63) / 64);
+    h.varWords = std::max(1u, (nVars + 63) / 64);
+    h.rows.setCols(h.rowWords);
+    h.vars.setCols(h.varWords);
+    h.rows.reserve(lines.size());
+    h.vars.reserve(lines.size());
+    for (unsigned i = 0; i < lines.size(); i++) {
+      h.rows.appendRow()[i / 64] |= uint64_t(1) << (i % 64);
+      uint64_t *v = h.vars.appendRow();
+      for (unsigned k = 0; k < nVars; k++) {
+        if (lines[i][k] != 0) v[k / 64] |= uint64_t(1) << (k % 64);
+      }
+    }
+    h.columns.resize(nVars);
+    std::iota(h.columns.begin(), h.columns.end(), 0);
+    h.eliminated.assign(h.varWords, 0);
+    return h;
   }
 
-  Rational<T> operator=(const Rational<T> &other) {
-    numerator = other.numerator;
-    denominator = other.denominator;
-    return *this;
+  static unsigned popcount(const uint64_t *bits, unsigned words) {
+    unsigned n = 0;
+    for (unsigned w = 0; w < words; w++) n += __builtin_popcountll(bits[w]);
+    return n;
   }
+};
 
-  Rational<T> operator+(const Rational<T> &other) const {
-    Rational<T> rat(0, 1);
-    T lcm = std::lcm(denominator, other.denominator);
-    rat.denominator = lcm;
-    rat.numerator = numerator * (lcm / denominator) +
-                    other.numerator * (lcm / other.denominator);
-    T gcd = std::gcd(rat.numerator, rat.denominator);
-    rat.numerator /= gcd;
-    rat.denominator /= gcd;
-    return rat;
+/**
+ * Limits of one FM run: its wall time, and the rows and bytes of every
+ * intermediate system. Zero means no limit. The eliminations and the
+ * redundancy removal check them as they go and throw BudgetExceeded, and the
+ * engines then bound the pairs of the branch that ran over with LP0.
+ */
+struct Budget {
+  double seconds = 0;
+  size_t maxRows = 0;
+  size_t maxBytes = 0;
+  std::chrono::steady_clock::time_point deadline;
+
+  bool limited() const { return seconds > 0 || maxRows > 0 || maxBytes > 0; }
+
+  // Starts the clock of the time limit
+  void start() {
+    deadline = std::chrono::steady_clock::now() +
+               std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                   std::chrono::duration<double>(seconds));
   }
 
-  Rational<T> operator-(const Rational<T> &other) const {
-    return *this + (-other);
-  }
+  void check(size_t rows = 0, size_t bytes = 0) const;
+};
 
-  Rational<T> reciprocal() const {
-    Rational<T> rat(denominator, numerator);
-    return rat;
-  }
+class BudgetExceeded : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
 
-  Rational<T> operator*(const Rational<T> &other) const {
-    Rational<T> rat(numerator * other.numerator,
-                    denominator * other.denominator);
-    T gcd = std::gcd(rat.numerator, rat.denominator);
-    rat.numerator /= gcd;
-    rat.denominator /= gcd;
-    return rat;
+inline void Budget::check(size_t rows, size_t bytes) const {
+  if (maxRows > 0 && rows > maxRows) throw BudgetExceeded("row budget");
+  if (maxBytes > 0 && bytes > maxBytes) throw BudgetExceeded("memory budget");
+  if (seconds > 0 && std::chrono::steady_clock::now() > deadline) {
+    throw BudgetExceeded("time budget");
   }
+}
 
-  Rational<T> operator/(const Rational<T> &other) const {
-    return *this * other.reciprocal();
-  }
+// How the OA results are printed: their rows as the engine found them, the
+// canonical rows of their closed octagon, or its difference bound matrix
+enum class OAFormat { Rows, Octagon, Matrix };
 
-  bool operator==(const Rational<T> &other) const {
-    return numerator * other.denominator == other.numerator * denominator;
-  }
+template <class T>
+struct System {
+  // Fraction-free rows: line[0..nVars-1] * x >= line[nVars]. They are kept
+  // in lines, or in sparseLines when sparse is set.
+  Matrix<T> lines;
+  SparseMatrix<T> sparseLines;
+  bool sparse = false;
+  std::vector<std::string> varLabels;
+  unsigned nVars = 0, nLines = 0;
+  // Empty unless the system was produced by removeVar
+  History history;
 
-  bool operator==(const T &other) const { return *this == Rational(other, 1); }
+  // Sparse storage is used below this fill, on systems with at least
+  // kSparseMinVars variables (smaller rows gain nothing from it)
+  static constexpr double kSparseFill = 0.2;
+  static constexpr unsigned kSparseMinVars = 8;
 
-  bool operator!=(const Rational<T> &other) const { return !(*this == other); }
+  unsigned rows() const { return sparse ? sparseLines.size() : lines.size(); }
 
-  bool operator!=(const T &other) const { return !(*this == other); }
+  // Entry k of row i, whichever the storage
+  T coef(unsigned i, unsigned k) const {
+    return sparse ? sparseLines[i][k] : lines[i][k];
+  }
 
-  bool operator<=(const Rational<T> &other) const {
-    if (denominator > 0 && other.denominator > 0)
-      return numerator * other.denominator <= other.numerator * denominator;
-    else {
-      assert(false);
+  size_t nonzeros() const {
+    if (sparse) return sparseLines.nonzeros();
+    size_t nnz = 0;
+    for (auto line : lines) {
+      for (auto &v : line) {
+        if (v != T(0)) nnz++;
+      }
     }
+    return nnz;
   }
 
-  bool operator<=(const T &other) const { return *this <= Rational(other, 1); }
-
-  bool operator<(const Rational<T> &other) const {
-    if (denominator > 0 && other.denominator > 0)
-      return numerator * other.denominator < other.numerator * denominator;
-    assert(false);
-    return false;
+  // Moves the rows to the storage that suits their fill
+  void chooseStorage() {
+    bool wantSparse =
+        nVars >= kSparseMinVars &&
+        double(nonzeros()) < kSparseFill * rows() * double(nVars + 1);
+    if (wantSparse == sparse) return;
+    if (wantSparse) {
+      sparseLines = SparseMatrix<T>(nVars + 1);
+      sparseLines.reserve(lines.size(), nonzeros());
+      for (auto line : lines) sparseLines.pushDense(line.data());
+      lines = Matrix<T>();
+    } else {
+      denseLines(lines);
+      sparseLines = SparseMatrix<T>();
+    }
+    sparse = wantSparse;
   }
 
-  bool operator<(const T &other) const { return *this < Rational(other, 1); }
-
-  bool operator>=(const Rational<T> &other) const {
-    if (denominator > 0 && other.denominator > 0)
-      return numerator * other.denominator >= other.numerator * denominator;
-    assert(false);
-    return false;
+  // The rows as a dense matrix, expanded into scratch if they are sparse
+  const Matrix<T> &denseLines(Matrix<T> &scratch) const {
+    if (!sparse) return lines;
+    scratch = Matrix<T>(nVars + 1);
+    scratch.reserve(sparseLines.size());
+    for (unsigned i = 0; i < sparseLines.size(); i++) {
+      sparseLines.toDense(i, scratch.appendRow());
+    }
+    return scratch;
   }
 
-  bool operator>=(const T &other) const { return *this >= Rational(other, 1); }
-
-  bool operator>(const Rational<T> &other) const {
-    if (denominator > 0 && other.denominator > 0)
-      return numerator * other.denominator > other.numerator * denominator;
-    assert(false);
-    return false;
+  void read(std::istream &in) {
+    unsigned rows, cols;
+    in >> rows >> cols;
+    beginInput(rows, cols - 2);
+    std::vector<Rational<T>> line(nVars + 1);
+    std::vector<T> row(nVars + 1);
+    int type;
+    for (unsigned i = 0; i < rows; i++) {
+      in >> type;
+      for (unsigned j = 0; j < nVars + 1; j++) {
+        line[j] = Rational<T>::read(in);
+      }
+      pushInputRow(line, type == 0, row);
+    }
+    endInput();
   }
 
-  bool operator>(const T &other) const { return *this > Rational(other, 1); }
-};
+  // Reads a system in the FMLib format from a text buffer, returns false on
+  // malformed input
+  bool read(TextScanner &in) {
+    unsigned rows, cols;
+    if (!in.readInteger(rows) || !in.readInteger(cols) || cols < 2 ||
+        !fitsInput(in, rows, cols)) {
+      return false;
+    }
+    beginInput(rows, cols - 2);
+    std::vector<Rational<T>> line(nVars + 1);
+    std::vector<T> row(nVars + 1);
+    int type;
+    for (unsigned i = 0; i < rows; i++) {
+      if (!in.readInteger(type)) return false;
+      for (unsigned j = 0; j < nVars + 1; j++) {
+        if (!in.readRational(line[j])) return false;
+      }
+      pushInputRow(line, type == 0, row);
+    }
+    endInput();
+    return true;
+  }
 
-template <class T>
-struct VarBounds {
-  bool posMaxFound = false;
-  bool negMaxFound = false;
-  Rational<T> posMax;
-  Rational<T> negMax;
-};
+  // Reads an H-representation in the cddlib format, whose rows b -A stand
+  // for b - A x >= 0 and are equalities if listed by linearity. Returns
+  // false on malformed input or real numbers.
+  bool readCdd(TextScanner &in) {
+    std::string_view tok;
+    std::vector<unsigned> linearity;
+    while (in.token(tok) && tok != "begin") {
+      if (tok != "linearity") continue;
+      unsigned k, index;
+      if (!in.readInteger(k)) return false;
+      for (unsigned i = 0; i < k; i++) {
+        if (!in.readInteger(index)) return false;
+        linearity.push_back(index);
+      }
+    }
+    unsigned rows, cols;
+    std::string_view numberType;
+    if (tok != "begin" || !in.readInteger(rows) || !in.readInteger(cols) ||
+        cols < 1 || !in.token(numberType) || numberType == "real" ||
+        !fitsInput(in, rows, cols)) {
+      return false;
+    }
+    beginInput(rows, cols - 1);
+    std::vector<char> equality(rows, false);
+    for (unsigned index : linearity) {
+      if (index >= 1 && index <= rows) equality[index - 1] = true;
+    }
+    std::vector<Rational<T>> line(nVars + 1);
+    std::vector<T> row(nVars + 1);
+    for (unsigned i = 0; i < rows; i++) {
+      if (!in.readRational(line[nVars])) return false;
+      for (unsigned j = 0; j < nVars; j++) {
+        if (!in.readRational(line[j])) return false;
+      }
+      pushInputRow(line, equality[i], row);
+    }
+    if (!in.token(tok) || tok != "end") return false;
+    endInput();
+    return true;
+  }
 
-template <class T>
-void makeDenominatorsOne(std::vector<Rational<T>> &line) {
-  T l = 1;
-  for (auto &rat : line) {
-    l = std::lcm(l, rat.denominator);
+  // Reads a system in the binary format from [pos, last) and moves pos past
+  // it, returns false on malformed input
+  bool readBinary(const char *&pos, const char *last) {
+    if (size_t(last - pos) < kBinaryHeaderBytes ||
+        std::memcmp(pos, kBinaryMagic, sizeof(kBinaryMagic)) != 0) {
+      return false;
+    }
+    uint32_t rows, vars;
+    std::memcpy(&rows, pos + sizeof(kBinaryMagic), 4);
+    std::memcpy(&vars, pos + sizeof(kBinaryMagic) + 4, 4);
+    const char *p = pos + kBinaryHeaderBytes;
+    if (size_t(last - p) / 8 / (size_t(vars) + 1) < rows) return false;
+    beginInput(rows, vars);
+    for (unsigned i = 0; i < rows; i++) {
+      T *dst = lines.appendRow();
+      for (unsigned j = 0; j <= nVars; j++, p += 8) {
+        int64_t v;
+        std::memcpy(&v, p, 8);
+        dst[j] = T(v);
+      }
+    }
+    pos = p;
+    endInput();
+    return true;
   }
-  for (auto &rat : line) {
-    rat.numerator = (rat.numerator * l) / rat.denominator;
-    rat.denominator = 1;
+
+  // Writes the system in the binary format, returns false (and writes
+  // nothing) if some entry does not fit in an int64_t
+  bool writeBinary(std::ostream &out) const {
+    std::vector<int64_t> values;
+    values.reserve(size_t(nLines) * (nVars + 1));
+    for (unsigned i = 0; i < nLines; i++) {
+      for (unsigned j = 0; j <= nVars; j++) {
+        int64_t v;
+        if (!toInt64(coef(i, j), v)) return false;
+        values.push_back(v);
+      }
+    }
+    uint32_t header[2] = {nLines, nVars};
+    out.write(kBinaryMagic, sizeof(kBinaryMagic));
+    out.write(reinterpret_cast<const char *>(header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(values.data()),
+              values.size() * sizeof(int64_t));
+    return bool(out);
   }
-}
 
-template <class T>
-struct System {
-  std::vector<std::vector<Rational<T>>> lines;
-  std::vector<std::string> varLabels;
-  unsigned nVars = 0, nLines = 0;
+  // Whether rows rows of cols tokens each may still follow in the buffer,
+  // so that a header which promises more is a parse error rather than an
+  // allocation of its size
+  static bool fitsInput(const TextScanner &in, unsigned rows, unsigned cols) {
+    return size_t(rows) * cols <= in.remaining();
+  }
 
-  void read(std::istream &in) {
-    in >> nLines >> nVars;
-    nVars = nVars - 2;
-    int type;
+  // Room reserved for the rows of an input before they are read. A header
+  // is not trusted beyond this, the matrix grows as the rows come.
+  static constexpr unsigned kInputReserveRows = 1 << 16;
 
+  // Starts an empty system of n variables with room for its first rows
+  void beginInput(unsigned rows, unsigned n) {
+    nVars = n;
+    varLabels.clear();
     for (unsigned i = 0; i < nVars; i++) {
       varLabels.push_back("x[" + std::to_string(i) + "]");
     }
+    lines = Matrix<T>();
+    lines.setCols(nVars + 1);
+    lines.reserve(std::min(rows, kInputReserveRows));
+    sparseLines = SparseMatrix<T>();
+    sparse = false;
+    history.clear();
+  }
 
-    for (unsigned i = 0; i < nLines; i++) {
-      std::vector<Rational<T>> line;
-      in >> type;
+  // Appends the input row a * x + c >= 0 (= 0 if equality), given as a
+  // followed by c, as the fraction-free row a * x >= -c. row is scratch.
+  void pushInputRow(std::vector<Rational<T>> &line, bool equality,
+                    std::vector<T> &row) {
+    // Changing + c >= 0 to  >= -c
+    line[nVars] = -line[nVars];
+    makeDenominatorsOne(line);
+    for (unsigned j = 0; j < nVars + 1; j++) {
+      row[j] = line[j].numerator;
+    }
+    lines.pushRow(row);
+    if (equality) {
       for (unsigned j = 0; j < nVars + 1; j++) {
-        Rational<T> rat = Rational<T>::read(in);
-        // Changing + c >= 0 to  >= -c
-        if (j == nVars) rat = -rat;
-        line.push_back(rat);
-      }
-      lines.push_back(line);
-      if (type == 0) {
-        std::vector<Rational<T>> line2 = line;
-        for (unsigned j = 0; j < nVars + 1; j++) {
-          line2[j] = -line2[j];
-        }
-        lines.push_back(line2);
+        row[j] = -row[j];
       }
+      lines.pushRow(row);
     }
+  }
 
+  void endInput() {
     nLines = lines.size();
-
-    for (auto &line : lines) {
-      makeDenominatorsOne(line);
-    }
+    chooseStorage();
   }
 
-  void print(std::ostream &out) const {
-    if (lines.size() == 0) return;
+  // With unitRows, rows whose variables all have coefficients of the same
+  // magnitude (such as the UTVPI bounds of a result) are printed with unit
+  // coefficients and a rational constant
+  void print(std::ostream &out, bool unitRows = false) const {
+    if (rows() == 0) return;
     for (auto &var : varLabels) {
       out << " " << var;
     }
     out << " c" << std::endl;
-    for (auto &line : lines) {
+    std::vector<T> row(sparse ? nVars + 1 : 0);
+    for (unsigned i = 0; i < rows(); i++) {
       out << 1;
-      print_vector(out, line);
+      if (sparse) {
+        sparseLines.toDense(i, row.data());
+        print_vector(out, row, unitRows);
+      } else {
+        print_vector(out, lines.row(i), unitRows);
+      }
     }
   }
 
-  static void print_vector(std::ostream &out,
-                           const std::vector<Rational<T>> &v) {
+  // Closed octagon of a system of UTVPI rows such as an OA result. Returns
+  // false if it is empty.
+  bool toOctagon(Octagon<T> &octagon) const {
+    octagon = Octagon<T>(nVars);
+    std::vector<std::pair<unsigned, int>> terms;
+    Rational<T> bound;
+    for (unsigned i = 0; i < rows(); i++) {
+      if (utvpiRow(i, terms, bound)) octagon.addBound(terms, bound);
+    }
+    return octagon.close();
+  }
+
+  void printOA(std::ostream &out, OAFormat format) const {
+    if (format == OAFormat::Rows) {
+      print(out, true);
+      return;
+    }
+    Octagon<T> octagon(nVars);
+    toOctagon(octagon);
+    if (format == OAFormat::Octagon)
+      octagon.print(out, varLabels);
+    else
+      octagon.printMatrix(out, varLabels);
+  }
+
+  template <class Row>
+  static void print_vector(std::ostream &out, const Row &v,
+                           bool unitRows = false) {
+    T g = 0;
+    for (unsigned i = 0; unitRows && i + 1 < v.size(); i++) {
+      if (v[i] == T(0)) continue;
+      T a = v[i] < T(0) ? -v[i] : v[i];
+      if (g == T(0)) {
+        g = a;
+      } else if (a != g) {
+        g = 1;
+        break;
+      }
+    }
+    if (g == T(0)) g = 1;
     for (unsigned i = 0; i < v.size(); i++) {
       out << " ";
       if (i + 1 == v.size())
-        (-v[i]).print(out);
+        Rational<T>(-v[i], g).print(out);
       else
-        v[i].print(out);
+        out << v[i] / g;
     }
     out << std::endl;
   }
 
-  System<T> removeVar(unsigned var, bool remove_redundant = true) const {
+  // Appends the row sum(sign * x[var]) >= bound
+  void addBound(const std::vector<std::pair<unsigned, int>> &terms,
+                const Rational<T> &bound) {
+    assert(bound.denominator > T(0));
+    if (lines.empty()) lines.setCols(nVars + 1);
+    T *line = lines.appendRow();
+    for (auto &term : terms) {
+      line[term.first] = T(term.second) * bound.denominator;
+    }
+    line[nVars] = bound.numerator;
+  }
+
+  System<T> removeVar(unsigned var, bool remove_redundant = true,
+                      const Budget *budget = nullptr) const {
     System<T> res;
     res.varLabels = varLabels;
     res.varLabels.erase(res.varLabels.begin() + var);
+    res.nVars = nVars - 1;
+    res.sparse = sparse;
+    res.lines.setCols(nVars);
+    res.sparseLines.setCols(nVars);
+
+    // A system without history is the origin of its own eliminations
+    History fresh;
+    if (history.empty()) {
+      fresh = sparse ? History::start(sparseLines, nVars)
+                     : History::start(lines, nVars);
+    }
+    const History &hist = history.empty() ? fresh : history;
+    History &resHist = res.history;
+    resHist.rowWords = hist.rowWords;
+    resHist.varWords = hist.varWords;
+    resHist.rows.setCols(hist.rowWords);
+    resHist.vars.setCols(hist.varWords);
+    resHist.columns = hist.columns;
+    resHist.columns.erase(resHist.columns.begin() + var);
+    resHist.eliminated = hist.eliminated;
+    resHist.eliminated[hist.columns[var] / 64] |= uint64_t(1)
+                                                  << (hist.columns[var] % 64);
+    resHist.nEliminated = hist.nEliminated + 1;
+
+    std::vector<unsigned> pos, neg;
+    std::vector<T> varCoef(nLines);
+    unsigned nZero = 0;
     for (unsigned i = 0; i < nLines; i++) {
-      if (lines[i][var] == 0) {
-        auto line = lines[i];
-        line.erase(line.begin() + var);
-        res.lines.push_back(line);
-        continue;
+      varCoef[i] = coef(i, var);
+      if (varCoef[i] > T(0))
+        pos.push_back(i);
+      else if (varCoef[i] < T(0))
+        neg.push_back(i);
+      else
+        nZero++;
+    }
+    // Most pairs are usually dropped, so the output grows as needed instead
+    // of reserving room for all of them, which could exhaust memory before
+    // the budget is first checked
+    if (!sparse) res.lines.reserve(nZero + pos.size() + neg.size());
+
+    // Rows without var are copied with the column dropped
+    std::vector<unsigned> index;
+    std::vector<T> value;
+    for (unsigned i = 0; i < nLines; i++) {
+      if (varCoef[i] != T(0)) continue;
+      if (sparse) {
+        auto src = sparseLines[i];
+        index.assign(src.index, src.index + src.nnz);
+        for (auto &k : index) {
+          if (k > var) k--;
+        }
+        res.sparseLines.pushRow(index.data(), src.value, src.nnz);
+      } else {
+        const T *src = lines[i];
+        T *dst = res.lines.appendRow();
+        for (unsigned k = 0, l = 0; k <= nVars; k++) {
+          if (k != var) dst[l++] = src[k];
+        }
+      }
+      resHist.rows.pushRow(hist.rows[i]);
+      resHist.vars.pushRow(hist.vars[i]);
+    }
+
+    // Rows whose words the combination kernel can work on
+    std::vector<char> narrow;
+    kernel::CombineFn fast = nullptr;
+    if constexpr (RowWords<T>::kEnabled) {
+      if (!sparse) {
+        fast = kernel::combineKernel();
+        narrow.assign(nLines, false);
+        for (unsigned i = 0; i < nLines; i++) {
+          if (varCoef[i] == T(0)) continue;
+          narrow[i] = kernel::narrow(RowWords<T>::get(lines[i]), nVars + 1);
+        }
+      }
+    }
+
+    // Every positive row is combined with the negative ones it passes the
+    // Chernikov criterion with, a block of them at a time, straight into
+    // the output. Dense rows are combined first and those the Imbert
+    // criterion drops are then compacted away.
+    std::vector<uint64_t> rowSet(hist.rowWords), varSet(hist.varWords);
+    std::vector<CombinedPair> pairs;
+    unsigned present[kCombineBlock];
+    uint64_t nChernikov = 0, nImbert = 0;
+    // Upper estimate of the bytes of a row of the result
+    size_t rowBytes =
+        size_t(nVars) * sizeof(T) + size_t(hist.rowWords + hist.varWords) * 8;
+    for (unsigned i : pos) {
+      pairs.clear();
+      for (unsigned j : neg) {
+        for (unsigned w = 0; w < hist.rowWords; w++) {
+          rowSet[w] = hist.rows[i][w] | hist.rows[j][w];
+        }
+        // Chernikov: after k eliminations, a row combined from more than
+        // k + 1 origin rows is redundant
+        unsigned nOrigins = History::popcount(rowSet.data(), hist.rowWords);
+        if (nOrigins > resHist.nEliminated + 1) {
+          nChernikov++;
+          continue;
+        }
+
+        // Fraction-free combination, the multipliers are kept small by
+        // dividing out their gcd
+        T c1 = varCoef[i];
+        T c2 = -varCoef[j];
+        T g = gcd(c1, c2);
+        pairs.push_back({j, nOrigins, c2 / g, c1 / g});
       }
-      if (lines[i][var] < 0) continue;
-      for (unsigned j = 0; j < nLines; j++) {
-        if (lines[j][var] >= 0 || i == j) continue;
-        Rational<T> c1 = lines[i][var];
-        Rational<T> c2 = lines[j][var];
-        auto line = vectorLinearSum(-c2, lines[i], c1, lines[j]);
-        assert(line[var] == Rational<T>(0));
-        assert(line.size() == nVars + 1);
-        line.erase(line.begin() + var);
-        bool all_zeros = true;
-        for (auto &r : line) {
-          if (r != Rational<T>(0, 1)) {
-            all_zeros = false;
-            break;
+
+      for (unsigned start = 0; start < pairs.size(); start += kCombineBlock) {
+        if (budget) budget->check(res.rows(), res.rows() * rowBytes);
+        unsigned count = std::min<size_t>(kCombineBlock, pairs.size() - start);
+        const CombinedPair *block = pairs.data() + start;
+        unsigned first = res.lines.size(), out = first;
+        if (!sparse) {
+          for (unsigned k = 0; k < count; k++) res.lines.appendRow();
+          for (unsigned k = 0; k < count; k++) {
+            unsigned j = block[k].row;
+            bool words = fast && narrow[i] && narrow[j];
+            present[k] =
+                combineRows(block[k].a, lines[i], block[k].b, lines[j],
+                            res.lines[first + k], var, words ? fast : nullptr);
           }
         }
-        if (!all_zeros) res.lines.push_back(line);
+        for (unsigned k = 0; k < count; k++) {
+          unsigned j = block[k].row;
+          T *line = nullptr;
+          unsigned nPresent = 0;
+          bool all_zeros;
+          if (sparse) {
+            vectorLinearSum(block[k].a, sparseLines[i], block[k].b,
+                            sparseLines[j], var, index, value);
+            nPresent = index.size();
+            if (nPresent > 0 && index.back() == res.nVars) nPresent--;
+            all_zeros = index.empty();
+          } else {
+            line = res.lines[first + k];
+            nPresent = present[k];
+            all_zeros = nPresent == 0 && line[res.nVars] == T(0);
+          }
+
+          // Imbert: with E the eliminated variables occurring in the origin
+          // rows and I the other variables of the origin rows which vanished
+          // from the combination, a row with more than 1 + |E| + |I| origin
+          // rows is redundant
+          unsigned nEffective = 0, nRemaining = 0;
+          for (unsigned w = 0; w < hist.varWords; w++) {
+            varSet[w] = hist.vars[i][w] | hist.vars[j][w];
+            nEffective +=
+                __builtin_popcountll(varSet[w] & resHist.eliminated[w]);
+            nRemaining +=
+                __builtin_popcountll(varSet[w] & ~resHist.eliminated[w]);
+          }
+          unsigned nImplicit = nRemaining - nPresent;
+          if (all_zeros || block[k].nOrigins > 1 + nEffective + nImplicit) {
+            nImbert++;
+            continue;
+          }
+          if (sparse) {
+            normalizeRow(value.data(), value.size());
+            res.sparseLines.pushRow(index.data(), value.data(), index.size());
+          } else {
+            T *dst = res.lines[out++];
+            if (dst != line) std::swap_ranges(line, line + nVars, dst);
+            normalizeRow(dst, nVars);
+          }
+          for (unsigned w = 0; w < hist.rowWords; w++) {
+            rowSet[w] = hist.rows[i][w] | hist.rows[j][w];
+          }
+          resHist.rows.pushRow(rowSet.data());
+          resHist.vars.pushRow(varSet.data());
+        }
+        if (!sparse) {
+          while (res.lines.size() > out) res.lines.popRow();
+        }
       }
     }
-    res.nVars = nVars - 1;
-    res.nLines = res.lines.size();
+    res.nLines = res.rows();
+    if (budget) budget->check(res.nLines, res.nLines * rowBytes);
+    addStat(Counter::Eliminations);
+    addStat(Counter::Combinations, uint64_t(pos.size()) * neg.size());
+    addStat(Counter::ChernikovDrops, nChernikov);
+    addStat(Counter::ImbertDrops, nImbert);
+    addStat(Counter::RowsKept, res.nLines);
+    notePeakRows(res.nLines);
+    res.chooseStorage();
     if (remove_redundant) res.removeRedundantConstraints();
     return res;
   }
 
-  void removeRedundantConstraints() {
-    for (unsigned i = 0; i < lines.size(); i++) {
-      IloEnv env;
-      IloModel model(env);
-      IloNumVarArray vars(env);
-      for (unsigned j = 0; j < nVars; j++) {
-        vars.add(IloNumVar(env, -IloInfinity, IloInfinity));
+  // Eliminates var for the OA engines. The history criteria prune the
+  // combinations, and the LP redundancy pass only runs when the elimination
+  // made the system grow.
+  System<T> project(unsigned var, const Budget *budget = nullptr) const {
+    System<T> res = removeVar(var, false, budget);
+    if (res.nLines > nLines) res.removeRedundantConstraints(budget);
+    return res;
+  }
+
+  System<T> project(unsigned var, ThreadPool &pool,
+                    const Budget *budget = nullptr) const {
+    System<T> res = removeVar(var, false, budget);
+    if (res.nLines > nLines) res.removeRedundantConstraints(pool, budget);
+    return res;
+  }
+
+  // Drops every row implied by the other remaining ones. The rows are all
+  // checked on one exact simplex tableau, each check warm-starting from the
+  // basis left by the previous one.
+  //
+  // The history criteria are only valid as long as rows are dropped by them
+  // alone, so the reduced system becomes a new origin.
+  void removeRedundantConstraints(const Budget *budget = nullptr) {
+    Matrix<T> scratch;
+    std::vector<bool> distinct;
+    Simplex<T> simplex(distinctLines(scratch, distinct), nVars);
+    // An empty polyhedron is left as is, so that infeasibility is still
+    // found by the callers
+    if (!simplex.feasible()) return;
+    dropDuplicates(distinct);
+    std::vector<bool> keep(nLines);
+    for (unsigned i = 0; i < nLines; i++) {
+      if (budget) budget->check();
+      keep[i] = !simplex.removeIfRedundant(i);
+    }
+    addStat(Counter::RedundancyChecks, nLines);
+    addStat(Counter::RedundantRows,
+            std::count(keep.begin(), keep.end(), false));
+    compact(keep);
+  }
+
+  // Parallel version with the same result. A row which is not implied by all
+  // the other rows is not implied by any subset of them either, so every row
+  // is first checked against the full system, in parallel on one tableau per
+  // worker. Only the rows which pass this check are then checked again in
+  // order, as in the sequential pass.
+  void removeRedundantConstraints(ThreadPool &pool,
+                                  const Budget *budget = nullptr) {
+    if (pool.size() == 1 || nLines < kParallelRedundancyRows) {
+      removeRedundantConstraints(budget);
+      return;
+    }
+    Matrix<T> scratch;
+    std::vector<bool> distinct;
+    const Matrix<T> &dense = distinctLines(scratch, distinct);
+    std::vector<std::unique_ptr<Simplex<T>>> simplex(pool.size());
+    simplex[0].reset(new Simplex<T>(dense, nVars));
+    if (!simplex[0]->feasible()) return;
+    dropDuplicates(distinct);
+    std::vector<char> candidate(nLines, false);
+    parallelFor(pool, nLines, 1, [&](unsigned i) {
+      std::unique_ptr<Simplex<T>> &s = simplex[pool.currentWorker()];
+      if (!s) s.reset(new Simplex<T>(dense, nVars));
+      if (budget) budget->check();
+      candidate[i] = s->isRedundant(i);
+    });
+    std::vector<bool> keep(nLines);
+    for (unsigned i = 0; i < nLines; i++) {
+      if (candidate[i] && budget) budget->check();
+      keep[i] = !candidate[i] || !simplex[0]->removeIfRedundant(i);
+    }
+    addStat(Counter::RedundancyChecks,
+            nLines + std::count(candidate.begin(), candidate.end(), true));
+    addStat(Counter::RedundantRows,
+            std::count(keep.begin(), keep.end(), false));
+    compact(keep);
+  }
+
+  // The rows as a dense matrix, without the rows whose coefficients are
+  // those of another row with a larger constant, or of a later row with the
+  // same constant. The row kept implies them, so the LP pass would drop
+  // them with a check each, and its result is the same without them. keep
+  // tells which rows are left. Rows are matched on a hash of their
+  // coefficients, and rows whose hashes collide are left to the LP pass.
+  const Matrix<T> &distinctLines(Matrix<T> &scratch,
+                                 std::vector<bool> &keep) const {
+    const Matrix<T> &dense = denseLines(scratch);
+    keep.assign(nLines, true);
+    std::unordered_map<uint64_t, unsigned> kept;
+    kept.reserve(nLines);
+    bool dropped = false;
+    for (unsigned i = 0; i < nLines; i++) {
+      uint64_t h = 0;
+      for (unsigned k = 0; k < nVars; k++) {
+        h = (h ^ hashValue(dense[i][k])) * 0x100000001b3u;
       }
-      for (unsigned j = 0; j < lines.size(); j++) {
-        int sign = (i == j) ? -1 : 1;
-        IloExpr expr(env);
-        for (unsigned k = 0; k < nVars; k++) {
-          double coeff = sign * double(lines[j][k].numerator) /
-                         double(lines[j][k].denominator);
-          expr += coeff * vars[k];
-        }
-        double rhs = sign * double(lines[j][nVars].numerator) /
-                     double(lines[j][nVars].denominator);
-        model.add(expr >= rhs);
+      auto found = kept.emplace(h, i);
+      if (found.second) continue;
+      unsigned &j = found.first->second;
+      if (!std::equal(dense[i], dense[i] + nVars, dense[j])) continue;
+      dropped = true;
+      if (dense[i][nVars] < dense[j][nVars]) {
+        keep[i] = false;
+      } else {
+        keep[j] = false;
+        j = i;
       }
-      IloCplex cplex(model);
-      cplex.setOut(env.getNullStream());
+    }
+    if (!dropped) return dense;
+    Matrix<T> distinct(nVars + 1);
+    for (unsigned i = 0; i < nLines; i++) {
+      if (keep[i]) distinct.pushRow(dense[i]);
+    }
+    scratch = std::move(distinct);
+    return scratch;
+  }
 
-      cplex.solve();
-      if (cplex.getStatus() == IloAlgorithm::Infeasible) {
-        lines.erase(lines.begin() + i);
-        i--;
-      }
-      env.end();
+  // Drops the rows distinctLines left out
+  void dropDuplicates(const std::vector<bool> &keep) {
+    uint64_t dropped = std::count(keep.begin(), keep.end(), false);
+    if (dropped == 0) return;
+    addStat(Counter::DuplicateRows, dropped);
+    compact(keep);
+  }
+
+  // Below this size the per-worker tableaus cost more than they save
+  static constexpr unsigned kParallelRedundancyRows = 64;
+
+  void compact(const std::vector<bool> &keep) {
+    if (sparse)
+      sparseLines.compactRows(keep);
+    else
+      lines.compactRows(keep);
+    nLines = rows();
+    history.clear();
+  }
+
+  // As append, but takes the rows of other when this system has none yet,
+  // as for the first part of a result
+  void append(System<T> &&other) {
+    if (rows() > 0 || other.sparse) {
+      append(static_cast<const System<T> &>(other));
+      return;
     }
+    assert(!sparse);
+    lines = std::move(other.lines);
+    nLines = lines.size();
+    other.nLines = 0;
+  }
 
+  // Appends the rows of another system over the same variables. Results are
+  // built with addBound, so this system is dense.
+  void append(const System<T> &other) {
+    assert(!sparse);
+    if (other.rows() == 0) return;
+    if (lines.empty()) lines.setCols(nVars + 1);
+    Matrix<T> scratch;
+    const Matrix<T> &src = other.denseLines(scratch);
+    lines.reserve(lines.size() + src.size());
+    for (auto line : src) lines.pushRow(line);
     nLines = lines.size();
   }
 
-  static std::vector<Rational<T>> vectorLinearSum(Rational<T> a,
-                                                  std::vector<Rational<T>> x,
-                                                  Rational<T> b,
-                                                  std::vector<Rational<T>> y) {
-    assert(x.size() == y.size());
-    auto res = x;
-    for (unsigned i = 0; i < res.size(); i++) {
+  // Positive rows are combined with up to this many negative rows at once
+  static constexpr unsigned kCombineBlock = 16;
+
+  // A negative row which passed the Chernikov criterion with the positive
+  // row being combined, and the multipliers of the pair
+  struct CombinedPair {
+    unsigned row, nOrigins;
+    T a, b;
+  };
+
+  // res = a * x + b * y for rows of nVars + 1 entries, with column var
+  // (which cancels) dropped. Returns the number of nonzero coefficients of
+  // res. fast is the kernel to use, when x and y are narrow rows of words.
+  unsigned combineRows(const T &a, const T *x, const T &b, const T *y,
+                       T *res, unsigned var, kernel::CombineFn fast) const {
+    unsigned n = nVars + 1;
+    if constexpr (RowWords<T>::kEnabled) {
+      if (fast) {
+        const int64_t *xw = RowWords<T>::get(x), *yw = RowWords<T>::get(y);
+        int64_t *rw = RowWords<T>::get(res);
+        int64_t aw = a.small(), bw = b.small();
+        unsigned nonzeros = fast(aw, xw, bw, yw, rw, var) +
+                            fast(aw, xw + var + 1, bw, yw + var + 1, rw + var,
+                                 n - var - 1);
+        return nonzeros - (rw[n - 2] != 0);
+      }
+    }
+    vectorLinearSum(a, x, b, y, res, var);
+    vectorLinearSum(a, x + var + 1, b, y + var + 1, res + var, n - var - 1);
+    unsigned nonzeros = 0;
+    for (unsigned k = 0; k + 2 < n; k++) {
+      if (res[k] != T(0)) nonzeros++;
+    }
+    return nonzeros;
+  }
+
+  // res[0..n-1] = a * x + b * y
+  static void vectorLinearSum(const T &a, const T *x, const T &b, const T *y,
+                              T *res, unsigned n) {
+    for (unsigned i = 0; i < n; i++) {
       res[i] = a * x[i] + b * y[i];
     }
+  }
+
+  // Sparse a * x + b * y, with column var (which cancels) dropped and the
+  // columns after it shifted down. Only the nonzero entries are kept.
+  static void vectorLinearSum(const T &a, typename SparseMatrix<T>::Row x,
+                              const T &b, typename SparseMatrix<T>::Row y,
+                              unsigned var, std::vector<unsigned> &index,
+                              std::vector<T> &value) {
+    index.clear();
+    value.clear();
+    unsigned p = 0, q = 0;
+    while (p < x.nnz || q < y.nnz) {
+      unsigned k;
+      T v;
+      if (q == y.nnz || (p < x.nnz && x.index[p] < y.index[q])) {
+        k = x.index[p];
+        v = a * x.value[p++];
+      } else if (p == x.nnz || y.index[q] < x.index[p]) {
+        k = y.index[q];
+        v = b * y.value[q++];
+      } else {
+        k = x.index[p];
+        v = a * x.value[p++] + b * y.value[q++];
+      }
+      if (k == var || v == T(0)) continue;
+      index.push_back(k > var ? k - 1 : k);
+      value.push_back(std::move(v));
+    }
+  }
+
+  using VarMap = std::map<std::string, unsigned>;
+  using SystemPtr = std::shared_ptr<const System<T>>;
+
+  // Default memory cap of the projection cache of one FM2 run
+  static constexpr size_t kProjectionCacheBytes = size_t(256) << 20;
+
+  // Cap of the projection cache of a run. Under a memory budget the cached
+  // systems count against it, and they may take at most half of it.
+  static size_t projectionCacheBytes(const Budget *budget) {
+    if (!budget || budget->maxBytes == 0) return kProjectionCacheBytes;
+    return std::min(kProjectionCacheBytes, budget->maxBytes / 2);
+  }
+
+  // Estimated cost of eliminating column var of a system next, used to pick
+  // the elimination order wherever the engines leave it free
+  using EliminationCost = std::function<double(const System<T> &, unsigned)>;
+
+  // Duffin's growth estimate: eliminating a variable with p positive and n
+  // negative occurrences replaces p + n rows by p * n
+  static double duffinCost(const System<T> &system, unsigned var) {
+    double p = 0, n = 0;
+    for (unsigned i = 0; i < system.nLines; i++) {
+      T c = system.coef(i, var);
+      if (c > T(0))
+        p++;
+      else if (c < T(0))
+        n++;
+    }
+    return p * n - (p + n);
+  }
+
+  // Ascending index order
+  static double indexCost(const System<T> &, unsigned var) { return var; }
+
+  // State shared by the tasks of one FM1 or FM2 run
+  struct OAContext {
+    const VarMap &varMap;
+    ThreadPool &pool;
+    ProjectionCache<System<T>> &cache;
+    const EliminationCost &cost;
+    // The system the run started from, whose column k is variable k
+    const System<T> &origin;
+    const Budget *budget;
+    // Tableaus of lpFallback on the origin system, one per worker
+    std::vector<std::unique_ptr<Simplex<T>>> fallback;
+  };
+
+  // The pairs of columns (a, b) of a system with a in [a0, a1), b in
+  // [b0, b1) and a < b, which one branch of FM1 or FM2 bounds
+  struct PairRange {
+    unsigned a0, a1, b0, b1;
+  };
+
+  // A branch of FM1 and its pairs, in the columns of the system it starts
+  // from
+  struct Branch {
+    std::function<bool(System<T> &)> run;
+    PairRange pairs;
+  };
+
+  // Calls f(v0, v1) on the variables of every pair of range
+  template <class F>
+  static void forPairs(const System<T> &system, const PairRange &range,
+                       const OAContext &ctx, F f) {
+    for (unsigned a = range.a0; a < range.a1; a++) {
+      for (unsigned b = std::max(range.b0, a + 1); b < range.b1; b++) {
+        f(ctx.varMap.at(system.varLabels[a]),
+          ctx.varMap.at(system.varLabels[b]));
+      }
+    }
+  }
+
+  // Bounds the pairs of range with LP0 on the origin system, for a branch
+  // that ran over the budget. Every pair gets the directions findBounds
+  // would give it, in the same order, in the system out(v0, v1). Returns
+  // false if the origin system is infeasible.
+  template <class Out>
+  static bool lpFallback(const System<T> &system, const PairRange &range,
+                         OAContext &ctx, Out out) {
+    auto &tableau = ctx.fallback[ctx.pool.currentWorker()];
+    if (!tableau) {
+      Matrix<T> scratch;
+      tableau.reset(
+          new Simplex<T>(ctx.origin.denseLines(scratch), ctx.origin.nVars));
+    }
+    Simplex<T> &lp = *tableau;
+    if (!lp.feasible()) return false;
+    unsigned n = ctx.varMap.size();
+    forPairs(system, range, ctx, [&](unsigned v0, unsigned v1) {
+      System<T> &res = out(v0, v1);
+      Rational<T> value;
+      for (auto &dir : pairDirections(v0, v1, n)) {
+        if (lp.minimize(dir, value)) res.addBound(dir, value);
+      }
+      res.nLines = res.lines.size();
+      addStat(Counter::BudgetFallbacks);
+    });
+    return true;
+  }
+
+  // The directions findBounds bounds for the pair (v0, v1) of n variables,
+  // in its order
+  static std::vector<std::vector<std::pair<unsigned, int>>> pairDirections(
+      unsigned v0, unsigned v1, unsigned n) {
+    std::vector<std::vector<std::pair<unsigned, int>>> dirs;
+    if (v0 + 1 == v1) dirs.insert(dirs.end(), {{{v0, 1}}, {{v0, -1}}});
+    if (v0 == 0 && v1 + 1 == n) {
+      dirs.insert(dirs.end(), {{{v1, 1}}, {{v1, -1}}});
+    }
+    dirs.insert(dirs.end(), {{{v0, 1}, {v1, 1}},
+                             {{v0, -1}, {v1, -1}},
+                             {{v0, 1}, {v1, -1}},
+                             {{v0, -1}, {v1, 1}}});
+    return dirs;
+  }
+
+  // Cheapest column in [begin, end), the first one on ties
+  static unsigned nextToEliminate(const System<T> &system, unsigned begin,
+                                  unsigned end, const OAContext &ctx) {
+    unsigned best = begin;
+    double bestCost = ctx.cost(system, begin);
+    for (unsigned c = begin + 1; c < end; c++) {
+      double cost = ctx.cost(system, c);
+      if (cost < bestCost) {
+        best = c;
+        bestCost = cost;
+      }
+    }
+    return best;
+  }
+
+  // Bitset of the input variables that occur in this system
+  VarSet varSet(const VarMap &varMap) const {
+    VarSet set((varMap.size() + 63) / 64, 0);
+    for (auto &label : varLabels) {
+      unsigned v = varMap.at(label);
+      set[v / 64] |= uint64_t(1) << (v % 64);
+    }
+    return set;
+  }
+
+  // Approximate footprint, as charged to the projection cache
+  size_t memoryBytes() const {
+    return sizeof(System<T>) + size_t(lines.size()) * lines.cols() * sizeof(T) +
+           sparseLines.nonzeros() * (sizeof(T) + sizeof(unsigned)) +
+           size_t(sparseLines.size()) * sizeof(unsigned) +
+           size_t(history.rows.size()) * history.rowWords * 8 +
+           size_t(history.vars.size()) * history.varWords * 8;
+  }
+
+  // project(var), unless the same set of variables has already been reached
+  // along another path. The projected polyhedron only depends on the set of
+  // eliminated variables, so any cached system for it can be used instead.
+  // Only FM2 reaches a set twice: the paths of FM1 all differ, so it
+  // projects without the cache.
+  static SystemPtr cachedProject(const System<T> &system, unsigned var,
+                                 OAContext &ctx) {
+    VarSet key = system.varSet(ctx.varMap);
+    unsigned v = ctx.varMap.at(system.varLabels[var]);
+    key[v / 64] &= ~(uint64_t(1) << (v % 64));
+    if (SystemPtr hit = ctx.cache.get(key)) return hit;
+    // The bytes held by the cache count against the memory budget
+    Budget rest;
+    const Budget *budget = ctx.budget;
+    if (budget && budget->maxBytes > 0) {
+      rest = *budget;
+      size_t held = ctx.cache.bytes();
+      rest.maxBytes = held < rest.maxBytes ? rest.maxBytes - held : 1;
+      budget = &rest;
+    }
+    SystemPtr res = std::make_shared<const System<T>>(
+        system.project(var, ctx.pool, budget));
+    ctx.cache.put(key, res, res->memoryBytes());
     return res;
   }
 
+  // Runs the branches of one FM1 level as tasks, each collecting its bounds
+  // in its own buffer. The buffers are appended to result in branch order,
+  // which is the order of the sequential recursion, so the result does not
+  // depend on the schedule.
+  //
+  // A branch which runs over the budget is bounded by lpFallback instead.
+  static bool forkBranches(const System<T> &system, System<T> &result,
+                           OAContext &ctx,
+                           const std::vector<Branch> &branches) {
+    std::vector<System<T>> parts(branches.size());
+    std::vector<char> ok(branches.size(), false);
+    auto run = [&](unsigned b) {
+      try {
+        ok[b] = branches[b].run(parts[b]);
+      } catch (const BudgetExceeded &) {
+        parts[b] = System<T>();
+        parts[b].nVars = result.nVars;
+        ok[b] = lpFallback(system, branches[b].pairs, ctx,
+                           [&](unsigned, unsigned) -> System<T> & {
+                             return parts[b];
+                           });
+      }
+    };
+    TaskGroup group(ctx.pool);
+    for (unsigned b = 0; b < branches.size(); b++) {
+      parts[b].nVars = result.nVars;
+      if (b + 1 < branches.size()) group.run([&, b] { run(b); });
+    }
+    run(branches.size() - 1);
+    group.wait();
+    for (unsigned b = 0; b < branches.size(); b++) {
+      if (!ok[b]) return false;
+      result.append(std::move(parts[b]));
+    }
+    return true;
+  }
+
   static bool findOA_f(const System<T> &system, System<T> &result,
-                       std::map<std::string, unsigned> &varMap) {
+                       OAContext &ctx) {
+    PhaseTimer timer(Phase::FindOA_f, ctx.varMap.size() - system.nVars);
     if (system.nVars == 2) {
-      return findBounds(system, result, varMap);
+      return findBounds(system, result, ctx.varMap);
     }
-    bool r = findOA_f(system.removeVar(system.nVars - 1), result, varMap);
-    if (!r) return false;
-    r = findOA_g(system.removeVar(system.nVars - 2), result, varMap);
-    if (!r) return false;
-    return findOA_h(system, result, varMap);
+    unsigned m = system.nVars;
+    return forkBranches(
+        system, result, ctx,
+        {{[&](System<T> &out) {
+            return findOA_f(system.project(m - 1, ctx.pool, ctx.budget), out,
+                            ctx);
+          },
+          {0, m - 1, 0, m - 1}},
+         {[&](System<T> &out) {
+            return findOA_g(system.project(m - 2, ctx.pool, ctx.budget), out,
+                            ctx);
+          },
+          {0, m - 2, m - 1, m}},
+         {[&](System<T> &out) { return findOA_h(system, out, ctx); },
+          {m - 2, m - 1, m - 1, m}}});
   }
 
   static bool findOA_g(const System<T> &system, System<T> &result,
-                       std::map<std::string, unsigned> &varMap) {
+                       OAContext &ctx) {
+    PhaseTimer timer(Phase::FindOA_g, ctx.varMap.size() - system.nVars);
     if (system.nVars == 2) {
-      return findBounds(system, result, varMap);
+      return findBounds(system, result, ctx.varMap);
     }
-    bool r = findOA_g(system.removeVar(system.nVars - 2), result, varMap);
-    if (!r) return false;
-    return findOA_h(system, result, varMap);
+    unsigned m = system.nVars;
+    return forkBranches(
+        system, result, ctx,
+        {{[&](System<T> &out) {
+            return findOA_g(system.project(m - 2, ctx.pool, ctx.budget), out,
+                            ctx);
+          },
+          {0, m - 2, m - 1, m}},
+         {[&](System<T> &out) { return findOA_h(system, out, ctx); },
+          {m - 2, m - 1, m - 1, m}}});
   }
 
+  // Projects onto the last two variables. The order in which the others are
+  // eliminated is free, so the cheapest one goes first.
   static bool findOA_h(const System<T> &system, System<T> &result,
-                       std::map<std::string, unsigned> &varMap) {
+                       OAContext &ctx) {
+    PhaseTimer timer(Phase::FindOA_h, ctx.varMap.size() - system.nVars);
     if (system.nVars == 2) {
-      return findBounds(system, result, varMap);
+      return findBounds(system, result, ctx.varMap);
     }
-    return findOA_h(system.removeVar(0), result, varMap);
+    unsigned var = nextToEliminate(system, 0, system.nVars - 2, ctx);
+    return findOA_h(system.project(var, ctx.pool, ctx.budget), result, ctx);
   }
 
+  // The unary bounds of the pair when it is first or last in the variable
+  // order, then the bounds along (+,+), (-,-), (+,-) and (-,+). The other
+  // variable is eliminated by boundsWithout, on the rows of the system or
+  // on a view of them in the rotated coordinates, so no system is built.
   static bool findBounds(const System<T> &system, System<T> &result,
-                         std::map<std::string, unsigned> &varMap) {
-    assert(system.nVars == 2);
-    if (varMap[system.varLabels[0]] + 1 == varMap[system.varLabels[1]]) {
-      auto res = simplifySingleVar(system.removeVar(1));
-      if (res.first) {
-        VarBounds<T> b = res.second;
-        if (b.posMaxFound) {
-          std::vector<Rational<T>> line(result.nVars + 1, 0);
-          line[varMap[system.varLabels[0]]] = Rational<T>(1);
-          line[result.nVars] = b.posMax;
-          result.lines.push_back(line);
-        }
-        if (b.negMaxFound) {
-          std::vector<Rational<T>> line(result.nVars + 1, 0);
-          line[varMap[system.varLabels[0]]] = Rational<T>(-1);
-          line[result.nVars] = b.negMax;
-          result.lines.push_back(line);
-        }
-      } else {
-        return false;
+                         const VarMap &varMap) {
+    // Systems under kSparseMinVars variables are always dense
+    assert(system.nVars == 2 && !system.sparse);
+    unsigned v0 = varMap.at(system.varLabels[0]);
+    unsigned v1 = varMap.at(system.varLabels[1]);
+    const Matrix<T> &lines = system.lines;
+    unsigned n = system.nLines;
+    auto entry = [&](unsigned i, unsigned k) { return lines[i][k]; };
+    // a0 x0 + a1 x1 >= c is (a0 + a1) u + (a0 - a1) w >= 2c, with u = x0 + x1
+    // and w = x0 - x1
+    auto rotated = [&](unsigned i, unsigned k) {
+      const T *line = lines[i];
+      if (k == 0) return line[0] + line[1];
+      if (k == 1) return line[0] - line[1];
+      return line[2] * T(2);
+    };
+    if (v0 + 1 == v1 &&
+        !addBounds(result, boundsWithout(n, 1, entry), {{v0, 1}},
+                   {{v0, -1}})) {
+      return false;
+    }
+    if (v0 == 0 && v1 + 1 == varMap.size() &&
+        !addBounds(result, boundsWithout(n, 0, entry), {{v1, 1}},
+                   {{v1, -1}})) {
+      return false;
+    }
+    return addBounds(result, boundsWithout(n, 1, rotated),
+                     {{v0, 1}, {v1, 1}}, {{v0, -1}, {v1, -1}}) &&
+           addBounds(result, boundsWithout(n, 0, rotated),
+                     {{v0, 1}, {v1, -1}}, {{v0, -1}, {v1, 1}});
+  }
+
+  // Adds the bounds found along dir and its opposite, returns false if
+  // there are none because the system is infeasible
+  static bool addBounds(System<T> &result,
+                        const std::pair<bool, VarBounds<T>> &found,
+                        const std::vector<std::pair<unsigned, int>> &dir,
+                        const std::vector<std::pair<unsigned, int>> &opposite) {
+    if (!found.first) return false;
+    const VarBounds<T> &b = found.second;
+    if (b.posMaxFound) result.addBound(dir, b.posMax);
+    if (b.negMaxFound) result.addBound(opposite, b.negMax);
+    return true;
+  }
+
+  // Bounds on the other column of the nLines rows entry(i, 0..2) of a
+  // two-variable system once column var is eliminated. This is
+  // simplifySingleVar(removeVar(var)) without building either system: every
+  // combination is folded into the bounds as it is made. The history
+  // criteria and the redundancy pass of removeVar only drop rows that the
+  // bounds of the others imply, so the bounds are the same.
+  template <class Entry>
+  static std::pair<bool, VarBounds<T>> boundsWithout(unsigned nLines,
+                                                     unsigned var,
+                                                     Entry entry) {
+    unsigned other = 1 - var;
+    VarBounds<T> bounds;
+    std::vector<unsigned> pos, neg;
+    for (unsigned i = 0; i < nLines; i++) {
+      T a = entry(i, var);
+      if (a > T(0)) {
+        pos.push_back(i);
+      } else if (a < T(0)) {
+        neg.push_back(i);
+      } else if (!tighten(bounds, entry(i, other), entry(i, 2))) {
+        return std::make_pair(false, bounds);
       }
-    } else if (varMap[system.varLabels[0]] == 0 &&
-               varMap[system.varLabels[1]] + 1 == varMap.size()) {
-      auto res = simplifySingleVar(system.removeVar(0));
-      if (res.first) {
-        VarBounds<T> b = res.second;
-        if (b.posMaxFound) {
-          std::vector<Rational<T>> line(result.nVars + 1, 0);
-          line[varMap[system.varLabels[1]]] = Rational<T>(1);
-          line[result.nVars] = b.posMax;
-          result.lines.push_back(line);
-        }
-        if (b.negMaxFound) {
-          std::vector<Rational<T>> line(result.nVars + 1, 0);
-          line[varMap[system.varLabels[1]]] = Rational<T>(-1);
-          line[result.nVars] = b.negMax;
-          result.lines.push_back(line);
+    }
+    for (unsigned i : pos) {
+      for (unsigned j : neg) {
+        T c1 = entry(i, var);
+        T c2 = -entry(j, var);
+        T g = gcd(c1, c2);
+        T a = c2 / g, b = c1 / g;
+        if (!tighten(bounds, a * entry(i, other) + b * entry(j, other),
+                     a * entry(i, 2) + b * entry(j, 2))) {
+          return std::make_pair(false, bounds);
         }
-      } else {
-        return false;
       }
     }
+    return std::make_pair(consistent(bounds), bounds);
+  }
 
-    System<T> rotated = system;
-    rotated.varLabels[0] = system.varLabels[0] + "+" + system.varLabels[1];
-    rotated.varLabels[1] = system.varLabels[0] + "-" + system.varLabels[1];
-    for (unsigned i = 0; i < system.nLines; i++) {
-      rotated.lines[i][0] = system.lines[i][0] + system.lines[i][1];
-      rotated.lines[i][1] = system.lines[i][0] - system.lines[i][1];
-      rotated.lines[i][2] = system.lines[i][2] * Rational<T>(2, 1);
-    }
-    auto res = simplifySingleVar(rotated.removeVar(1));
-    if (res.first) {
-      VarBounds<T> b = res.second;
-      if (b.posMaxFound) {
-        std::vector<Rational<T>> line(result.nVars + 1, 0);
-        line[varMap[system.varLabels[0]]] = Rational<T>(1);
-        line[varMap[system.varLabels[1]]] = Rational<T>(1);
-        line[result.nVars] = b.posMax;
-        result.lines.push_back(line);
-      }
-      if (b.negMaxFound) {
-        std::vector<Rational<T>> line(result.nVars + 1, 0);
-        line[varMap[system.varLabels[0]]] = Rational<T>(-1);
-        line[varMap[system.varLabels[1]]] = Rational<T>(-1);
-        line[result.nVars] = b.negMax;
-        result.lines.push_back(line);
+  // Adds the row a * x >= c to the bounds, returns false if it has no
+  // solution
+  static bool tighten(VarBounds<T> &bounds, const T &a, const T &c) {
+    if (a > T(0)) {
+      Rational<T> val(c, a);
+      if (!bounds.posMaxFound || bounds.posMax < val) {
+        bounds.posMaxFound = true;
+        bounds.posMax = val;
       }
-    } else {
-      return false;
-    }
-    res = simplifySingleVar(rotated.removeVar(0));
-    if (res.first) {
-      VarBounds<T> b = res.second;
-      if (b.posMaxFound) {
-        std::vector<Rational<T>> line(result.nVars + 1, 0);
-        line[varMap[system.varLabels[0]]] = Rational<T>(1);
-        line[varMap[system.varLabels[1]]] = Rational<T>(-1);
-        line[result.nVars] = b.posMax;
-        result.lines.push_back(line);
-      }
-      if (b.negMaxFound) {
-        std::vector<Rational<T>> line(result.nVars + 1, 0);
-        line[varMap[system.varLabels[0]]] = Rational<T>(-1);
-        line[varMap[system.varLabels[1]]] = Rational<T>(1);
-        line[result.nVars] = b.negMax;
-        result.lines.push_back(line);
+    } else if (a < T(0)) {
+      Rational<T> val(c, -a);
+      if (!bounds.negMaxFound || bounds.negMax < val) {
+        bounds.negMaxFound = true;
+        bounds.negMax = val;
       }
-    } else {
+    } else if (c > T(0)) {
       return false;
     }
     return true;
   }
 
+  // x >= posMax and -x >= negMax
+  static bool consistent(const VarBounds<T> &bounds) {
+    return !(bounds.posMaxFound && bounds.negMaxFound &&
+             bounds.posMax + bounds.negMax > T(0));
+  }
+
   static std::pair<bool, VarBounds<T>> simplifySingleVar(
       const System<T> &system) {
     assert(system.nVars == 1);
     VarBounds<T> varBounds;
-    for (auto &line : system.lines) {
-      if (line[0] > 0) {
-        auto val = line[1] / line[0];
-        if (varBounds.posMaxFound && varBounds.posMax > val) {
-          varBounds.posMax = val;
-        } else if (!varBounds.posMaxFound) {
-          varBounds.posMaxFound = true;
-          varBounds.posMax = val;
-        }
-      } else if (line[0] < 0) {
-        auto val = line[1] / (-line[0]);
-        if (varBounds.negMaxFound && varBounds.negMax > val) {
-          varBounds.negMax = val;
-        } else if (!varBounds.negMaxFound) {
-          varBounds.negMaxFound = true;
-          varBounds.negMax = val;
-        }
-      } else if (line[1] > 0) {
+    for (auto line : system.lines) {
+      if (!tighten(varBounds, line[0], line[1])) {
         return std::make_pair(false, varBounds);
       }
     }
-    return std::make_pair(true, varBounds);
+    return std::make_pair(consistent(varBounds), varBounds);
   }
 
   void printFMOA(std::ostream &out, bool vanilla = false) {
+    ThreadPool pool;
+    printFMOA(out, pool, vanilla);
+  }
+
+  void printFMOA(std::ostream &out, ThreadPool &pool, bool vanilla = false) {
+    ProjectionCache<System<T>> cache(kProjectionCacheBytes);
+    printFMOA(out, pool, cache, vanilla);
+  }
+
+  // The cache may be shared by several FM2 runs on this system, and only FM2
+  // uses it. The budget covers the whole run, over all the components, and
+  // under a memory budget the cache is capped by projectionCacheBytes.
+  void printFMOA(std::ostream &out, ThreadPool &pool,
+                 ProjectionCache<System<T>> &cache, bool vanilla = false,
+                 const EliminationCost &cost = duffinCost,
+                 OAFormat format = OAFormat::Rows, Budget budget = Budget()) {
+    budget.start();
+    const Budget *limits = budget.limited() ? &budget : nullptr;
+    size_t cacheBytes = projectionCacheBytes(limits);
+    cache.limit(cacheBytes);
     System<T> result;
     result.varLabels = varLabels;
     result.nVars = nVars;
-    std::map<std::string, unsigned> varMap;
-    for (unsigned i = 0; i < nVars; i++) {
-      varMap[varLabels[i]] = i;
-    }
-    bool r;
-    if (vanilla)
-      r = vanillaFMOA(*this, result, varMap);
-    else
-      r = findOA_f(*this, result, varMap);
+    // Cache keys are relative to the system the projections start from, so
+    // only a component with all the variables may use the given cache. The
+    // others share its budget by their number of variables.
+    bool r = presolvedOA(
+        result, pool,
+        [&](const System<T> &sub, System<T> &res, const Seeds &) {
+          if (sub.nVars == nVars) {
+            return sub.findFMOA(res, pool, cache, vanilla, cost, limits);
+          }
+          ProjectionCache<System<T>> local(cacheBytes / nVars * sub.nVars);
+          return sub.findFMOA(res, pool, local, vanilla, cost, limits);
+        });
     if (!r) {
       out << "Infeasible!" << std::endl;
     } else {
-      result.print(out);
+      result.printOA(out, format);
     }
   }
 
-  void printLPOA(std::ostream &out) {
-    System<T> result;
-    result.varLabels = varLabels;
-    result.nVars = nVars;
-    std::map<std::string, unsigned> varMap;
+  // FM1, or FM2 with vanilla, on the whole system. The branches which run
+  // over the budget, if one is given, are bounded with LP0 instead.
+  bool findFMOA(System<T> &result, ThreadPool &pool,
+                ProjectionCache<System<T>> &cache, bool vanilla,
+                const EliminationCost &cost,
+                const Budget *budget = nullptr) const {
+    VarMap varMap;
     for (unsigned i = 0; i < nVars; i++) {
       varMap[varLabels[i]] = i;
     }
-    bool r = findLPOA(*this, result, varMap);
-    if (!r) {
-      out << "Infeasible!" << std::endl;
-    } else {
-      result.print(out);
+    OAContext ctx{varMap, pool, cache, cost, *this, budget,
+                  std::vector<std::unique_ptr<Simplex<T>>>(pool.size())};
+    if (vanilla) return vanillaFMOA(*this, result, ctx);
+    return findOA_f(*this, result, ctx);
+  }
+
+  // Connected components of the variable co-occurrence graph, each a sorted
+  // list of variables, ordered by their first variable. Variables which
+  // occur in no row form components of their own.
+  std::vector<std::vector<unsigned>> components() const {
+    std::vector<unsigned> parent(nVars);
+    std::iota(parent.begin(), parent.end(), 0);
+    auto find = [&](unsigned v) {
+      while (parent[v] != v) v = parent[v] = parent[parent[v]];
+      return v;
+    };
+    for (unsigned i = 0; i < nLines; i++) {
+      int first = -1;
+      for (unsigned k = 0; k < nVars; k++) {
+        if (coef(i, k) == T(0)) continue;
+        if (first < 0) {
+          first = find(k);
+        } else {
+          unsigned r = find(k);
+          if (r != unsigned(first)) parent[std::max<unsigned>(r, first)] =
+              std::min<unsigned>(r, first);
+          first = find(k);
+        }
+      }
+    }
+    std::vector<std::vector<unsigned>> comps;
+    std::vector<int> id(nVars, -1);
+    for (unsigned v = 0; v < nVars; v++) {
+      unsigned r = find(v);
+      if (id[r] < 0) {
+        id[r] = comps.size();
+        comps.emplace_back();
+      }
+      comps[id[r]].push_back(v);
     }
+    return comps;
   }
 
-  static bool vanillaFMOA(const System<T> &system, System<T> &result,
-                          std::map<std::string, unsigned> varMap) {
-    for (unsigned i = 0; i < system.nVars; i++) {
-      for (unsigned j = i + 1; j < system.nVars; j++) {
-        System<T> temp = system;
-        unsigned nRemoved = 0;
-        for (unsigned k = 0; k < system.nVars; k++) {
-          if (k != i && k != j) {
-            temp = temp.removeVar(k - nRemoved);
-            nRemoved++;
+  // Rounds of bound propagation; a round visits every row once
+  static constexpr unsigned kPropagationRounds = 8;
+
+  // Interval propagation: tightens the bounds of every variable from every
+  // row a * x >= b, using the largest value the other terms of the row can
+  // take, until nothing changes or after kPropagationRounds rounds. Returns
+  // false if a row or a pair of bounds cannot be met.
+  bool propagateBounds(std::vector<VarBounds<T>> &bounds) const {
+    bounds.assign(nVars, VarBounds<T>());
+    // Largest value of a * x_k, false if it is unbounded
+    auto sup = [&](unsigned k, const T &a, Rational<T> &v) {
+      const VarBounds<T> &b = bounds[k];
+      if (a > T(0) ? !b.negMaxFound : !b.posMaxFound) return false;
+      v = a > T(0) ? Rational<T>(-a) * b.negMax : Rational<T>(a) * b.posMax;
+      return true;
+    };
+    for (unsigned round = 0; round < kPropagationRounds; round++) {
+      bool changed = false;
+      for (unsigned i = 0; i < nLines; i++) {
+        Rational<T> total(0), v;
+        unsigned nUnbounded = 0, unbounded = 0;
+        for (unsigned k = 0; k < nVars; k++) {
+          T a = coef(i, k);
+          if (a == T(0)) continue;
+          if (sup(k, a, v)) {
+            total = total + v;
+          } else {
+            nUnbounded++;
+            unbounded = k;
           }
         }
-        bool r = findBounds(temp, result, varMap);
-        if (!r) {
-          return false;
+        Rational<T> b(coef(i, nVars));
+        if (nUnbounded == 0 && total < b) return false;
+        if (nUnbounded > 1) continue;
+        for (unsigned k = 0; k < nVars; k++) {
+          T a = coef(i, k);
+          if (a == T(0) || (nUnbounded == 1 && k != unbounded)) continue;
+          Rational<T> rest = total;
+          if (nUnbounded == 0) {
+            sup(k, a, v);
+            rest = rest - v;
+          }
+          // a * x_k >= b - rest
+          Rational<T> bound = (b - rest) / Rational<T>(a > T(0) ? a : -a);
+          VarBounds<T> &vb = bounds[k];
+          bool &found = a > T(0) ? vb.posMaxFound : vb.negMaxFound;
+          Rational<T> &max = a > T(0) ? vb.posMax : vb.negMax;
+          if (found && !(max < bound)) continue;
+          found = true;
+          max = bound;
+          changed = true;
+          if (vb.posMaxFound && vb.negMaxFound && vb.posMax + vb.negMax > T(0))
+            return false;
         }
       }
+      if (!changed) break;
     }
-    result.nLines = result.lines.size();
     return true;
   }
 
-  static bool findLPOA(const System<T> &system, System<T> &result,
-                       std::map<std::string, unsigned> varMap) {
-    IloEnv env;
-    IloModel model(env);
-    IloNumVarArray vars(env);
-    for (unsigned j = 0; j < system.nVars; j++) {
-      vars.add(IloNumVar(env, -IloInfinity, IloInfinity));
+  // Substitutes the variables which bounds fixes by their values. A fixed
+  // variable keeps its column, which is left with the two rows x = value,
+  // so it becomes a component of its own. Returns false if a row without
+  // variables is left that cannot be met, and leaves out untouched if no
+  // variable is fixed.
+  bool substituteFixed(const std::vector<VarBounds<T>> &bounds,
+                       System<T> &out) const {
+    std::vector<char> fixed(nVars, false);
+    bool any = false;
+    for (unsigned k = 0; k < nVars; k++) {
+      const VarBounds<T> &b = bounds[k];
+      fixed[k] = b.posMaxFound && b.negMaxFound && b.posMax == -b.negMax;
+      any = any || fixed[k];
     }
-    for (auto &line : system.lines) {
-      IloExpr expr(env);
-      for (unsigned k = 0; k < system.nVars; k++) {
-        double coeff = double(line[k].numerator) / double(line[k].denominator);
-        expr += coeff * vars[k];
+    if (!any) return true;
+
+    out.varLabels = varLabels;
+    out.nVars = nVars;
+    out.lines.setCols(nVars + 1);
+    out.lines.reserve(nLines);
+    for (unsigned i = 0; i < nLines; i++) {
+      std::vector<Rational<T>> line(nVars + 1);
+      bool hasVar = false;
+      line[nVars] = Rational<T>(coef(i, nVars));
+      for (unsigned k = 0; k < nVars; k++) {
+        T a = coef(i, k);
+        if (a == T(0)) continue;
+        if (fixed[k]) {
+          line[nVars] = line[nVars] - Rational<T>(a) * bounds[k].posMax;
+        } else {
+          line[k] = Rational<T>(a);
+          hasVar = true;
+        }
       }
-      double rhs = double(line[system.nVars].numerator) /
-                   double(line[system.nVars].denominator);
-      model.add(expr >= rhs);
+      if (!hasVar) {
+        if (line[nVars] > T(0)) return false;
+        continue;
+      }
+      makeDenominatorsOne(line);
+      T *row = out.lines.appendRow();
+      for (unsigned k = 0; k <= nVars; k++) row[k] = line[k].numerator;
+      normalizeRow(row, nVars + 1);
+    }
+    for (unsigned k = 0; k < nVars; k++) {
+      if (!fixed[k]) continue;
+      out.addBound({{k, 1}}, bounds[k].posMax);
+      out.addBound({{k, -1}}, bounds[k].negMax);
     }
+    out.nLines = out.lines.size();
+    out.chooseStorage();
+    return true;
+  }
 
-    IloCplex cplex(model);
-    cplex.setOut(env.getNullStream());
+  // The rows rowIdx, which only involve the variables vars, as a system
+  // over those variables
+  System<T> restrict(const std::vector<unsigned> &vars,
+                     const std::vector<unsigned> &rowIdx) const {
+    System<T> sub;
+    sub.nVars = vars.size();
+    for (unsigned v : vars) sub.varLabels.push_back(varLabels[v]);
+    sub.lines.setCols(sub.nVars + 1);
+    sub.lines.reserve(rowIdx.size());
+    for (unsigned i : rowIdx) {
+      T *dst = sub.lines.appendRow();
+      for (unsigned k = 0; k < sub.nVars; k++) dst[k] = coef(i, vars[k]);
+      dst[sub.nVars] = coef(i, nVars);
+    }
+    sub.nLines = sub.lines.size();
+    sub.chooseStorage();
+    return sub;
+  }
 
-    cplex.extract(model);
-    cplex.solve();
+  // Lower bounds of the UTVPI directions, indexed as in lpDirections
+  struct DirectionBounds {
+    std::vector<char> found;
+    std::vector<Rational<T>> value;
 
-    if (cplex.getStatus() == IloAlgorithm::Infeasible) {
-      return false;
+    explicit DirectionBounds(unsigned n)
+        : found(2 * n * n, false), value(2 * n * n) {}
+
+    void tighten(unsigned d, const Rational<T> &v) {
+      if (found[d] && !(value[d] < v)) return;
+      found[d] = true;
+      value[d] = v;
     }
+  };
+
+  // Bounds implied by the UTVPI rows of a system. The directions marked
+  // exact are known to reach their bound on the whole system, so no engine
+  // needs to minimize them.
+  // An exact direction without a bound is unbounded. feasible is set once
+  // some point of the system is known.
+  struct Seeds {
+    DirectionBounds bounds;
+    std::vector<char> exact;
+    bool feasible = false;
+
+    explicit Seeds(unsigned n) : bounds(n), exact(2 * n * n, false) {}
+
+    bool complete() const {
+      return std::find(exact.begin(), exact.end(), false) == exact.end();
+    }
+  };
+
+  // Computes the over-approximation of a system over the variables of one
+  // component. The seeds of the system are given, so an engine may skip the
+  // exact directions.
+  using OAEngine =
+      std::function<bool(const System<T> &, System<T> &, const Seeds &)>;
+
+  // Terms and bound of row i if it is a UTVPI row, i.e. has one or two
+  // variables with coefficients of the same magnitude
+  bool utvpiRow(unsigned i, std::vector<std::pair<unsigned, int>> &terms,
+                Rational<T> &bound) const {
+    terms.clear();
+    T d(0);
+    for (unsigned k = 0; k < nVars; k++) {
+      T a = coef(i, k);
+      if (a == T(0)) continue;
+      T abs = a > T(0) ? a : -a;
+      if (terms.size() == 2 || (!terms.empty() && abs != d)) return false;
+      d = abs;
+      terms.push_back({k, a > T(0) ? 1 : -1});
+    }
+    if (terms.empty()) return false;
+    bound = Rational<T>(coef(i, nVars), d);
+    return true;
+  }
 
-    IloObjective obj = IloMaximize(env, vars[0]);
-    model.add(obj);
-    for (unsigned i = 0; i < system.nVars; i++) {
-      for (unsigned j = 0; j < system.nVars; j++) {
-        if (i == j) {
-          obj.setLinearCoef(vars[j], -1);
-        } else {
-          obj.setLinearCoef(vars[j], 0);
+  // Closes the octagon of the UTVPI rows to seed every direction. Without
+  // general rows the closure is exact. Otherwise a direction is exact if a
+  // minimizer of some direction over the octagon satisfies the general rows
+  // and reaches the seed of that direction. Returns false if the UTVPI rows
+  // alone are infeasible.
+  static bool seedBounds(const System<T> &system, Seeds &seeds) {
+    unsigned n = system.nVars;
+    Octagon<T> octagon(n);
+    std::vector<unsigned> general;
+    std::vector<std::pair<unsigned, int>> terms;
+    Rational<T> bound;
+    for (unsigned i = 0; i < system.nLines; i++) {
+      if (system.utvpiRow(i, terms, bound)) {
+        octagon.addBound(terms, bound);
+      } else {
+        general.push_back(i);
+      }
+    }
+    // The propagated bounds are implied by all the rows
+    std::vector<VarBounds<T>> intervals;
+    if (!system.propagateBounds(intervals)) return false;
+    for (unsigned k = 0; k < n; k++) {
+      if (intervals[k].posMaxFound)
+        octagon.addBound({{k, 1}}, intervals[k].posMax);
+      if (intervals[k].negMaxFound)
+        octagon.addBound({{k, -1}}, intervals[k].negMax);
+    }
+    if (!octagon.close()) return false;
+    auto dirs = lpDirections(n);
+    DirectionBounds &b = seeds.bounds;
+    for (unsigned d = 0; d < dirs.size(); d++) {
+      b.found[d] = octagon.lowerBound(dirs[d], b.value[d]);
+    }
+    if (general.empty()) {
+      std::fill(seeds.exact.begin(), seeds.exact.end(), true);
+      seeds.feasible = true;
+      return true;
+    }
+
+    // If no row has a positive coefficient on x_k, x_k can decrease without
+    // bound from any point, so every direction with +x_k is unbounded, and
+    // likewise for -x_k and negative coefficients
+    std::vector<char> hasPos(n, false), hasNeg(n, false);
+    for (unsigned i = 0; i < system.nLines; i++) {
+      for (unsigned k = 0; k < n; k++) {
+        T a = system.coef(i, k);
+        if (a > T(0)) hasPos[k] = true;
+        if (a < T(0)) hasNeg[k] = true;
+      }
+    }
+    for (unsigned d = 0; d < dirs.size(); d++) {
+      for (auto &t : dirs[d]) {
+        if (!(t.second > 0 ? hasPos : hasNeg)[t.first]) seeds.exact[d] = true;
+      }
+    }
+
+    auto value = [](const std::vector<std::pair<unsigned, int>> &dir,
+                    const std::vector<Rational<T>> &x) {
+      Rational<T> v(0);
+      for (auto &t : dir) v = t.second > 0 ? v + x[t.first] : v - x[t.first];
+      return v;
+    };
+    auto satisfies = [&](const std::vector<Rational<T>> &x) {
+      for (unsigned i : general) {
+        Rational<T> v(0);
+        for (unsigned k = 0; k < n; k++) {
+          T a = system.coef(i, k);
+          if (a != T(0)) v = v + Rational<T>(a) * x[k];
+        }
+        if (v < system.coef(i, n)) return false;
+      }
+      return true;
+    };
+    // A minimizer costs O(n^3), so the search stops after n of them in a row
+    // have been cut off by the general rows
+    unsigned misses = 0;
+    for (unsigned d = 0; d < dirs.size() && misses < n; d++) {
+      if (!b.found[d] || seeds.exact[d]) continue;
+      std::vector<Rational<T>> x = octagon.minimizer(dirs[d]);
+      if (!satisfies(x)) {
+        misses++;
+        continue;
+      }
+      misses = 0;
+      seeds.feasible = true;
+      for (unsigned e = 0; e < dirs.size(); e++) {
+        if (b.found[e] && value(dirs[e], x) == b.value[e]) {
+          seeds.exact[e] = true;
         }
       }
-      cplex.extract(model);
-      cplex.solve();
+    }
+    return true;
+  }
 
-      if (cplex.getStatus() == IloAlgorithm::Optimal) {
-        std::vector<Rational<T>> line(system.nVars + 1, 0);
-        line[i] = 1;
-        line[system.nVars] = -ceilNum(cplex.getObjValue());
-        result.lines.push_back(line);
+  // Seeds the bounds of the system and runs engine unless they are all
+  // exact
+  static bool seededOA(const System<T> &system, System<T> &result,
+                       const OAEngine &engine) {
+    Seeds seeds(system.nVars);
+    if (!seedBounds(system, seeds)) return false;
+    if (!seeds.complete() || !seeds.feasible) {
+      return engine(system, result, seeds);
+    }
+    auto dirs = lpDirections(system.nVars);
+    for (unsigned d = 0; d < dirs.size(); d++) {
+      if (seeds.bounds.found[d]) {
+        result.addBound(dirs[d], seeds.bounds.value[d]);
       }
+    }
+    result.nLines = result.lines.size();
+    return true;
+  }
 
-      obj.setLinearCoef(vars[i], 1);
-      cplex.extract(model);
-      cplex.solve();
+  static unsigned unaryIndex(unsigned i, int s) {
+    return 2 * i + (s > 0 ? 0 : 1);
+  }
 
-      if (cplex.getStatus() == IloAlgorithm::Optimal) {
-        std::vector<Rational<T>> line(system.nVars + 1, 0);
-        line[i] = -1;
-        line[system.nVars] = -ceilNum(cplex.getObjValue());
-        result.lines.push_back(line);
+  static unsigned pairIndex(unsigned n, unsigned i, int si, unsigned j,
+                            int sj) {
+    assert(i < j);
+    unsigned p = i * n - i * (i + 1) / 2 + (j - i - 1);
+    unsigned pattern = si == sj ? (si > 0 ? 0 : 1) : (si > 0 ? 2 : 3);
+    return 2 * n + 4 * p + pattern;
+  }
+
+  // Records the UTVPI rows of a component result, whose column k is the
+  // variable vars[k] of an n-variable system
+  static void collectBounds(const System<T> &part,
+                            const std::vector<unsigned> &vars, unsigned n,
+                            DirectionBounds &bounds) {
+    for (auto line : part.lines) {
+      unsigned col[2], nTerms = 0;
+      int sign[2];
+      T d;
+      for (unsigned k = 0; k < part.nVars; k++) {
+        if (line[k] == T(0)) continue;
+        assert(nTerms < 2);
+        col[nTerms] = vars[k];
+        sign[nTerms++] = line[k] > T(0) ? 1 : -1;
+        d = line[k] > T(0) ? line[k] : -line[k];
       }
+      Rational<T> v(line[part.nVars], d);
+      if (nTerms == 1)
+        bounds.tighten(unaryIndex(col[0], sign[0]), v);
+      else
+        bounds.tighten(pairIndex(n, col[0], sign[0], col[1], sign[1]), v);
     }
+  }
 
-    for (unsigned i = 0; i < system.nVars; i++) {
-      for (unsigned j = i + 1; j < system.nVars; j++) {
-        for (unsigned k = 0; k < system.nVars; k++) {
-          if (k == i || k == j) {
-            obj.setLinearCoef(vars[k], -1);
-          } else {
-            obj.setLinearCoef(vars[k], 0);
-          }
-        }
-        cplex.extract(model);
-        cplex.solve();
-
-        if (cplex.getStatus() == IloAlgorithm::Optimal) {
-          std::vector<Rational<T>> line(system.nVars + 1, 0);
-          line[i] = 1;
-          line[j] = 1;
-          line[system.nVars] = -ceilNum(cplex.getObjValue());
-          result.lines.push_back(line);
-        }
+  // Propagates bounds over the system, substitutes the fixed variables and
+  // runs decomposedOA on the components of what is left
+  bool presolvedOA(System<T> &result, ThreadPool &pool,
+                   const OAEngine &engine) const {
+    std::vector<VarBounds<T>> bounds;
+    if (!propagateBounds(bounds)) return false;
+    System<T> substituted;
+    if (!substituteFixed(bounds, substituted)) return false;
+    const System<T> &system = substituted.nVars ? substituted : *this;
+    return decomposedOA(system, system.components(), result, pool, engine);
+  }
 
-        obj.setLinearCoef(vars[j], 1);
-        obj.setLinearCoef(vars[j], 1);
-        cplex.extract(model);
-        cplex.solve();
-
-        if (cplex.getStatus() == IloAlgorithm::Optimal) {
-          std::vector<Rational<T>> line(system.nVars + 1, 0);
-          line[i] = -1;
-          line[j] = -1;
-          line[system.nVars] = -ceilNum(cplex.getObjValue());
-          result.lines.push_back(line);
-        }
+  // Runs seededOA on every component (in parallel) and combines the
+  // results. Bounds within a component come from its own result. The
+  // components are independent, so the minimum of +-x_i +- x_j for
+  // variables of different components is the sum of the two unary minima.
+  // The bounds are emitted in the order of lpDirections. Components of a
+  // single variable are UTVPI, so they never reach the engine.
+  static bool decomposedOA(const System<T> &system,
+                           const std::vector<std::vector<unsigned>> &comps,
+                           System<T> &result, ThreadPool &pool,
+                           const OAEngine &engine) {
+    if (comps.size() <= 1) return seededOA(system, result, engine);
+    unsigned n = system.nVars;
+    std::vector<unsigned> compOf(n);
+    for (unsigned c = 0; c < comps.size(); c++) {
+      for (unsigned v : comps[c]) compOf[v] = c;
+    }
+    std::vector<std::vector<unsigned>> compRows(comps.size());
+    for (unsigned i = 0; i < system.nLines; i++) {
+      unsigned k = 0;
+      while (k < n && system.coef(i, k) == T(0)) k++;
+      if (k < n) {
+        compRows[compOf[k]].push_back(i);
+      } else if (system.coef(i, n) > T(0)) {
+        // 0 >= c with c > 0
+        return false;
+      }
+    }
 
-        obj.setLinearCoef(vars[j], -1);
-        obj.setLinearCoef(vars[j], 1);
-        cplex.extract(model);
-        cplex.solve();
-
-        if (cplex.getStatus() == IloAlgorithm::Optimal) {
-          std::vector<Rational<T>> line(system.nVars + 1, 0);
-          line[i] = 1;
-          line[j] = -1;
-          line[system.nVars] = -ceilNum(cplex.getObjValue());
-          result.lines.push_back(line);
+    std::vector<System<T>> parts(comps.size());
+    std::vector<char> ok(comps.size(), false);
+    parallelFor(pool, comps.size(), 1, [&](unsigned c) {
+      System<T> sub = system.restrict(comps[c], compRows[c]);
+      parts[c].varLabels = sub.varLabels;
+      parts[c].nVars = sub.nVars;
+      ok[c] = seededOA(sub, parts[c], engine);
+    });
+
+    DirectionBounds bounds(n);
+    for (unsigned c = 0; c < comps.size(); c++) {
+      if (!ok[c]) return false;
+      collectBounds(parts[c], comps[c], n, bounds);
+    }
+    for (unsigned i = 0; i < n; i++) {
+      for (unsigned j = i + 1; j < n; j++) {
+        if (compOf[i] == compOf[j]) continue;
+        for (int si : {1, -1}) {
+          for (int sj : {1, -1}) {
+            unsigned bi = unaryIndex(i, si), bj = unaryIndex(j, sj);
+            if (!bounds.found[bi] || !bounds.found[bj]) continue;
+            bounds.tighten(pairIndex(n, i, si, j, sj),
+                           bounds.value[bi] + bounds.value[bj]);
+          }
         }
+      }
+    }
 
-        obj.setLinearCoef(vars[j], 1);
-        obj.setLinearCoef(vars[j], -1);
-        cplex.extract(model);
-        cplex.solve();
-
-        if (cplex.getStatus() == IloAlgorithm::Optimal) {
-          std::vector<Rational<T>> line(system.nVars + 1, 0);
-          line[i] = -1;
-          line[j] = 1;
-          line[system.nVars] = -ceilNum(cplex.getObjValue());
-          result.lines.push_back(line);
+    auto dirs = lpDirections(n);
+    for (unsigned d = 0; d < dirs.size(); d++) {
+      if (bounds.found[d]) result.addBound(dirs[d], bounds.value[d]);
+    }
+    result.nLines = result.lines.size();
+    return true;
+  }
+
+  // FM2: projects the system onto every pair of variables. The projections
+  // are computed on a pair tree: the variables are split in two halves, and
+  // the pairs inside each half and across the halves are found by recursing
+  // on systems with the other variables eliminated. Every projection is
+  // shared by all the pairs below it, so O(n^2) eliminations are done in
+  // total instead of n - 2 per pair. Sibling subtrees run as tasks, each pair
+  // writes its bounds to its own slot, and the slots are appended in (i, j)
+  // order, as in a sequential loop over the pairs.
+  static bool vanillaFMOA(const System<T> &system, System<T> &result,
+                          OAContext &ctx) {
+    PairSlots slots(ctx.varMap, system.nVars);
+    pairsWithin(system, slots, ctx);
+    for (unsigned i = 0; i < system.nVars; i++) {
+      for (unsigned j = i + 1; j < system.nVars; j++) {
+        if (!slots.ok[slots.index(i, j)]) {
+          return false;
         }
+        result.append(std::move(slots.bounds[slots.index(i, j)]));
       }
     }
-
-    env.end();
     result.nLines = result.lines.size();
     return true;
   }
 
-  static Rational<T> floorNum(double n, unsigned p = 10) {
-    T de = 1 << p;
-    T nu = std::floor(n * de);
-    return Rational<T>(nu, de);
+  // Per-pair results of FM2
+  struct PairSlots {
+    const VarMap &varMap;
+    unsigned n;
+    std::vector<System<T>> bounds;
+    std::vector<char> ok;
+
+    PairSlots(const VarMap &varMap, unsigned n)
+        : varMap(varMap), n(n), bounds(n * n), ok(n * n, true) {}
+
+    unsigned index(unsigned i, unsigned j) const { return i * n + j; }
+  };
+
+  // Eliminates the variables in columns [begin, end), cheapest first
+  static SystemPtr projectOut(const System<T> &system, unsigned begin,
+                              unsigned end, OAContext &ctx) {
+    assert(begin < end);
+    SystemPtr res;
+    for (const System<T> *cur = &system; end > begin; end--) {
+      res = cachedProject(*cur, nextToEliminate(*cur, begin, end, ctx), ctx);
+      cur = res.get();
+    }
+    return res;
+  }
+
+  static void pairBounds(const System<T> &system, PairSlots &slots) {
+    unsigned k = slots.index(slots.varMap.at(system.varLabels[0]),
+                             slots.varMap.at(system.varLabels[1]));
+    slots.bounds[k].nVars = slots.n;
+    slots.ok[k] = findBounds(system, slots.bounds[k], slots.varMap);
   }
 
-  static Rational<T> ceilNum(double n, unsigned p = 10) {
-    T de = 1 << p;
-    T nu = std::ceil(n * de);
-    return Rational<T>(nu, de);
+  // Runs the subtree of FM2 which bounds the pairs of range, or bounds them
+  // with LP0 if it runs over the budget
+  template <class F>
+  static void guarded(const System<T> &system, const PairRange &range,
+                      PairSlots &slots, OAContext &ctx, F subtree) {
+    try {
+      subtree();
+    } catch (const BudgetExceeded &) {
+      auto slot = [&](unsigned v0, unsigned v1) -> System<T> & {
+        unsigned k = slots.index(v0, v1);
+        slots.bounds[k] = System<T>();
+        slots.bounds[k].nVars = slots.n;
+        slots.ok[k] = true;
+        return slots.bounds[k];
+      };
+      if (!lpFallback(system, range, ctx, slot)) {
+        forPairs(system, range, ctx, [&](unsigned v0, unsigned v1) {
+          slots.ok[slots.index(v0, v1)] = false;
+        });
+      }
+    }
+  }
+
+  // All the pairs of variables of system
+  static void pairsWithin(const System<T> &system, PairSlots &slots,
+                          OAContext &ctx) {
+    unsigned m = system.nVars;
+    if (m < 2) return;
+    if (m == 2) {
+      pairBounds(system, slots);
+      return;
+    }
+    unsigned h = m / 2;
+    TaskGroup group(ctx.pool);
+    group.run([&] {
+      guarded(system, {0, h, 0, h}, slots, ctx, [&] {
+        pairsWithin(*projectOut(system, h, m, ctx), slots, ctx);
+      });
+    });
+    group.run([&] {
+      guarded(system, {h, m, h, m}, slots, ctx, [&] {
+        pairsWithin(*projectOut(system, 0, h, ctx), slots, ctx);
+      });
+    });
+    pairsAcross(system, h, slots, ctx);
+    group.wait();
+  }
+
+  // The pairs of a variable in columns [0, h) with one in [h, nVars). The
+  // larger side is split in two, and each half is paired with the other side
+  // after eliminating the other half.
+  static void pairsAcross(const System<T> &system, unsigned h,
+                          PairSlots &slots, OAContext &ctx) {
+    unsigned m = system.nVars;
+    if (m == 2) {
+      pairBounds(system, slots);
+      return;
+    }
+    TaskGroup group(ctx.pool);
+    if (h >= m - h) {
+      unsigned mid = h / 2;
+      group.run([&, mid] {
+        guarded(system, {0, mid, h, m}, slots, ctx, [&] {
+          pairsAcross(*projectOut(system, mid, h, ctx), mid, slots, ctx);
+        });
+      });
+      guarded(system, {mid, h, h, m}, slots, ctx, [&] {
+        pairsAcross(*projectOut(system, 0, mid, ctx), h - mid, slots, ctx);
+      });
+    } else {
+      unsigned mid = h + (m - h) / 2;
+      group.run([&, mid] {
+        guarded(system, {0, h, h, mid}, slots, ctx, [&] {
+          pairsAcross(*projectOut(system, mid, m, ctx), h, slots, ctx);
+        });
+      });
+      guarded(system, {0, h, mid, m}, slots, ctx, [&] {
+        pairsAcross(*projectOut(system, h, mid, ctx), h, slots, ctx);
+      });
+    }
+    group.wait();
+  }
+
+  void printLPOA(std::ostream &out) {
+    ThreadPool pool;
+    printLPOA(out, solverFactory<T, SimplexSolver>(), pool);
+  }
+
+  void printLPOA(std::ostream &out, const LPFactory<T> &factory,
+                 ThreadPool &pool, OAFormat format = OAFormat::Rows) {
+    LPBackends<T> backends(factory);
+    printLPOA(out, backends, pool, format);
+  }
+
+  // The backends may be kept across systems, e.g. for a batch
+  void printLPOA(std::ostream &out, LPBackends<T> &backends, ThreadPool &pool,
+                 OAFormat format = OAFormat::Rows) {
+    System<T> result;
+    result.varLabels = varLabels;
+    result.nVars = nVars;
+    bool r = presolvedOA(
+        result, pool,
+        [&](const System<T> &sub, System<T> &res, const Seeds &seeds) {
+          return findLPOA(sub, res, backends, pool, &seeds);
+        });
+    if (!r) {
+      out << "Infeasible!" << std::endl;
+    } else {
+      result.printOA(out, format);
+    }
+  }
+
+  // The UTVPI directions minimized by LP0, in output order: the unary ones
+  // first, then the four sign patterns of every pair
+  static std::vector<std::vector<std::pair<unsigned, int>>> lpDirections(
+      unsigned n) {
+    std::vector<std::vector<std::pair<unsigned, int>>> dirs;
+    dirs.reserve(2 * n + 2 * n * (n - 1));
+    for (unsigned i = 0; i < n; i++) {
+      dirs.push_back({{i, 1}});
+      dirs.push_back({{i, -1}});
+    }
+    for (unsigned i = 0; i < n; i++) {
+      for (unsigned j = i + 1; j < n; j++) {
+        dirs.push_back({{i, 1}, {j, 1}});
+        dirs.push_back({{i, -1}, {j, -1}});
+        dirs.push_back({{i, 1}, {j, -1}});
+        dirs.push_back({{i, -1}, {j, 1}});
+      }
+    }
+    return dirs;
+  }
+
+  // LP0: minimizes every unary and binary UTVPI direction over the system.
+  // The directions are independent once feasibility is known, so they are
+  // spread over the pool in chunks of consecutive directions. Every worker
+  // loads its own backend, which warm-starts each direction of a chunk from
+  // the previous one. The minima are collected per direction and added to
+  // the result in direction order, so the output does not depend on the
+  // schedule. The directions which seeds marks exact are not minimized.
+  static bool findLPOA(const System<T> &system, System<T> &result,
+                       const LPFactory<T> &factory, ThreadPool &pool,
+                       const Seeds *seeds = nullptr) {
+    LPBackends<T> backends(factory);
+    return findLPOA(system, result, backends, pool, seeds);
+  }
+
+  // Same, on backends taken from backends and given back at the end. Each
+  // worker loads the one it takes once, with this system.
+  static bool findLPOA(const System<T> &system, System<T> &result,
+                       LPBackends<T> &backends, ThreadPool &pool,
+                       const Seeds *seeds = nullptr) {
+    Matrix<T> scratch;
+    const Matrix<T> &dense = system.denseLines(scratch);
+    addStat(Counter::LPSystems);
+    std::vector<std::unique_ptr<LPSolver<T>>> solvers(pool.size());
+    auto load = [&](std::unique_ptr<LPSolver<T>> &lp) {
+      lp = backends.acquire();
+      addStat(Counter::LPLoads);
+      return lp->load(dense, system.nVars);
+    };
+    auto giveBack = [&] {
+      for (auto &lp : solvers) {
+        if (lp) backends.release(std::move(lp));
+      }
+    };
+    if (!load(solvers[pool.currentWorker()])) {
+      giveBack();
+      return false;
+    }
+    auto dirs = lpDirections(system.nVars);
+    std::vector<Rational<T>> values(dirs.size());
+    std::vector<char> found(dirs.size(), false);
+    unsigned grain = std::max<size_t>(1, dirs.size() / (8 * pool.size()));
+    parallelFor(pool, dirs.size(), grain, [&](unsigned d) {
+      if (seeds && seeds->exact[d]) {
+        found[d] = seeds->bounds.found[d];
+        values[d] = seeds->bounds.value[d];
+        addStat(Counter::SeededDirections);
+        return;
+      }
+      std::unique_ptr<LPSolver<T>> &lp = solvers[pool.currentWorker()];
+      if (!lp) load(lp);
+      found[d] = lp->minimize(dirs[d], values[d]);
+      addStat(Counter::LPSolves);
+    });
+    giveBack();
+    for (unsigned d = 0; d < dirs.size(); d++) {
+      if (found[d]) result.addBound(dirs[d], values[d]);
+    }
+    result.nLines = result.lines.size();
+    return true;
   }
 };
 
@@ -0,0 +1,141 @@
+#if !defined(UTVPI_OA_INCREMENTAL_H)
+#define UTVPI_OA_INCREMENTAL_H
+
+#include <cassert>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <utvpi_oa_fm.h>
+#include <utvpi_oa_octagon.h>
+#include <utvpi_oa_simplex.h>
+#include <utvpi_oa_stats.h>
+
+namespace fm {
+
+/**
+ * LP0 over-approximation of a system which grows one row at a time
+ *
+ * Every direction is minimized once on one exact simplex tableau, which
+ * gives a minimizer for a bounded direction and a ray along which it
+ * decreases without bound otherwise. A new row is added to the tableau,
+ * which restores feasibility from its current basis. A minimizer which
+ * satisfies the new row is still in the smaller polyhedron, so its direction
+ * keeps its minimum, and a ray whose direction the new row does not
+ * decrease still lies in it. Only the other directions are minimized again,
+ * each from the basis left by the previous query. The bounds are kept in a
+ * closed octagon.
+ */
+template <class T>
+class IncrementalOA {
+ public:
+  explicit IncrementalOA(const System<T> &system)
+      : system_(system),
+        dirs_(System<T>::lpDirections(system.nVars)),
+        found_(dirs_.size(), false),
+        value_(dirs_.size()),
+        point_(dirs_.size()),
+        octagon_(system.nVars) {
+    // The history criteria do not hold once rows are added
+    system_.history.clear();
+    Matrix<T> scratch;
+    simplex_.reset(new Simplex<T>(system.denseLines(scratch), system.nVars));
+    feasible_ = simplex_->feasible();
+    if (!feasible_) return;
+    for (unsigned d = 0; d < dirs_.size(); d++) {
+      solve(d);
+      if (found_[d]) octagon_.addBound(dirs_[d], value_[d]);
+    }
+    octagon_.close();
+  }
+
+  bool feasible() const { return feasible_; }
+
+  // The system with all the rows added so far
+  const System<T> &system() const { return system_; }
+
+  // The over-approximation as a closed octagon
+  const Octagon<T> &octagon() const { return octagon_; }
+
+  // Directions minimized again by the last addConstraint
+  unsigned resolved() const { return resolved_; }
+
+  // The over-approximation as rows, in the order of findLPOA
+  System<T> result() const {
+    System<T> res;
+    res.varLabels = system_.varLabels;
+    res.nVars = system_.nVars;
+    for (unsigned d = 0; d < dirs_.size(); d++) {
+      if (found_[d]) res.addBound(dirs_[d], value_[d]);
+    }
+    res.nLines = res.lines.size();
+    return res;
+  }
+
+  // Adds the row line[0..nVars-1] * x >= line[nVars] and updates the
+  // over-approximation. Returns false if the system is infeasible.
+  bool addConstraint(const std::vector<T> &line) {
+    unsigned n = system_.nVars;
+    assert(line.size() == n + 1);
+    resolved_ = 0;
+    if (!feasible_) return false;
+    if (system_.sparse) {
+      system_.sparseLines.pushDense(line.data());
+    } else {
+      if (system_.lines.empty()) system_.lines.setCols(n + 1);
+      system_.lines.pushRow(line.data());
+    }
+    system_.nLines++;
+    if (!simplex_->addRow(line.data())) {
+      feasible_ = false;
+      return false;
+    }
+
+    for (unsigned d = 0; d < dirs_.size(); d++) {
+      if (satisfies(point_[d], line, !found_[d])) continue;
+      bool wasFound = found_[d];
+      Rational<T> old = value_[d];
+      solve(d);
+      // Minima only grow, and a bound is never lost
+      if (found_[d] && (!wasFound || old < value_[d])) {
+        octagon_.addBoundAndClose(dirs_[d], value_[d]);
+      }
+    }
+    return true;
+  }
+
+ private:
+  System<T> system_;
+  std::vector<std::vector<std::pair<unsigned, int>>> dirs_;
+  std::unique_ptr<Simplex<T>> simplex_;
+  bool feasible_ = false;
+  // Minimum and minimizer of every direction if it is bounded, and
+  // otherwise a ray along which it is unbounded
+  std::vector<char> found_;
+  std::vector<Rational<T>> value_;
+  std::vector<std::vector<Rational<T>>> point_;
+  Octagon<T> octagon_;
+  unsigned resolved_ = 0;
+
+  void solve(unsigned d) {
+    found_[d] = simplex_->minimize(dirs_[d], value_[d]);
+    point_[d] = found_[d] ? simplex_->point() : simplex_->ray();
+    resolved_++;
+    addStat(Counter::LPSolves);
+  }
+
+  // Whether the point x satisfies the row, or the ray x does not decrease it
+  static bool satisfies(const std::vector<Rational<T>> &x,
+                        const std::vector<T> &line, bool ray) {
+    unsigned n = x.size();
+    Rational<T> v(0);
+    for (unsigned k = 0; k < n; k++) {
+      if (line[k] != T(0)) v = v + Rational<T>(line[k]) * x[k];
+    }
+    return !(v < (ray ? T(0) : line[n]));
+  }
+};
+
+}  // namespace fm
+
+#endif  // UTVPI_OA_INCREMENTAL_H
@@ -0,0 +1,615 @@
+#if !defined(UTVPI_OA_INTEGER_H)
+#define UTVPI_OA_INTEGER_H
+
+#include <cassert>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace fm {
+
+/**
+ * Arbitrary precision integer (sign and magnitude, 32 bit limbs)
+ */
+struct BigInt {
+  bool negative = false;
+  // Little-endian limbs without leading zeros, empty for zero
+  std::vector<uint32_t> mag;
+
+  BigInt() = default;
+
+  explicit BigInt(__int128 v) {
+    negative = v < 0;
+    unsigned __int128 u = negative ? -(unsigned __int128)v : v;
+    while (u != 0) {
+      mag.push_back(uint32_t(u));
+      u >>= 32;
+    }
+  }
+
+  bool isZero() const { return mag.empty(); }
+
+  void trim() {
+    while (!mag.empty() && mag.back() == 0) mag.pop_back();
+    if (mag.empty()) negative = false;
+  }
+
+  // Returns true and sets v if the value fits in an int64_t
+  bool toInt64(int64_t &v) const {
+    if (mag.size() > 2) return false;
+    uint64_t u = 0;
+    for (unsigned i = mag.size(); i-- > 0;) u = (u << 32) | mag[i];
+    if (negative) {
+      if (u > uint64_t(INT64_MAX) + 1) return false;
+      v = int64_t(0 - u);
+    } else {
+      if (u > uint64_t(INT64_MAX)) return false;
+      v = int64_t(u);
+    }
+    return true;
+  }
+
+  double toDouble() const {
+    double d = 0;
+    for (unsigned i = mag.size(); i-- > 0;) d = d * 4294967296.0 + mag[i];
+    return negative ? -d : d;
+  }
+
+  static int compareMag(const std::vector<uint32_t> &a,
+                        const std::vector<uint32_t> &b) {
+    if (a.size() != b.size()) return a.size() < b.size() ? -1 : 1;
+    for (unsigned i = a.size(); i-- > 0;) {
+      if (a[i] != b[i]) return a[i] < b[i] ? -1 : 1;
+    }
+    return 0;
+  }
+
+  static std::vector<uint32_t> addMag(const std::vector<uint32_t> &a,
+                                      const std::vector<uint32_t> &b) {
+    const auto &l = a.size() >= b.size() ? a : b;
+    const auto &s = a.size() >= b.size() ? b : a;
+    std::vector<uint32_t> r(l.size() + 1);
+    uint64_t carry = 0;
+    for (unsigned i = 0; i < l.size(); i++) {
+      uint64_t t = carry + l[i] + (i < s.size() ? s[i] : 0);
+      r[i] = uint32_t(t);
+      carry = t >> 32;
+    }
+    r[l.size()] = uint32_t(carry);
+    return r;
+  }
+
+  // Requires |a| >= |b|
+  static std::vector<uint32_t> subMag(const std::vector<uint32_t> &a,
+                                      const std::vector<uint32_t> &b) {
+    std::vector<uint32_t> r(a.size());
+    int64_t borrow = 0;
+    for (unsigned i = 0; i < a.size(); i++) {
+      int64_t t = int64_t(a[i]) - borrow - (i < b.size() ? b[i] : 0);
+      borrow = t < 0;
+      r[i] = uint32_t(t + (borrow << 32));
+    }
+    assert(borrow == 0);
+    return r;
+  }
+
+  static std::vector<uint32_t> mulMag(const std::vector<uint32_t> &a,
+                                      const std::vector<uint32_t> &b) {
+    std::vector<uint32_t> r(a.size() + b.size());
+    for (unsigned i = 0; i < a.size(); i++) {
+      uint64_t carry = 0;
+      for (unsigned j = 0; j < b.size(); j++) {
+        uint64_t t = uint64_t(a[i]) * b[j] + r[i + j] + carry;
+        r[i + j] = uint32_t(t);
+        carry = t >> 32;
+      }
+      r[i + b.size()] = uint32_t(carry);
+    }
+    return r;
+  }
+
+  // Knuth's algorithm D (Hacker's Delight, divmnu), requires b non-zero
+  static void divModMag(const std::vector<uint32_t> &u,
+                        const std::vector<uint32_t> &v,
+                        std::vector<uint32_t> &q, std::vector<uint32_t> &r) {
+    const uint64_t b = uint64_t(1) << 32;
+    unsigned m = u.size(), n = v.size();
+    assert(n > 0 && v[n - 1] != 0);
+    if (m < n) {
+      q.clear();
+      r = u;
+      return;
+    }
+    q.assign(m - n + 1, 0);
+    if (n == 1) {
+      uint64_t k = 0;
+      for (unsigned j = m; j-- > 0;) {
+        uint64_t cur = k * b + u[j];
+        q[j] = uint32_t(cur / v[0]);
+        k = cur - uint64_t(q[j]) * v[0];
+      }
+      r.assign(1, uint32_t(k));
+      return;
+    }
+    int s = __builtin_clz(v[n - 1]);
+    std::vector<uint32_t> vn(n), un(m + 1);
+    for (unsigned i = n - 1; i > 0; i--) {
+      vn[i] = (v[i] << s) | uint32_t(uint64_t(v[i - 1]) >> (32 - s));
+    }
+    vn[0] = v[0] << s;
+    un[m] = uint32_t(uint64_t(u[m - 1]) >> (32 - s));
+    for (unsigned i = m - 1; i > 0; i--) {
+      un[i] = (u[i] << s) | uint32_t(uint64_t(u[i - 1]) >> (32 - s));
+    }
+    un[0] = u[0] << s;
+    for (unsigned j = m - n + 1; j-- > 0;) {
+      uint64_t num = uint64_t(un[j + n]) * b + un[j + n - 1];
+      uint64_t qhat = num / vn[n - 1];
+      uint64_t rhat = num - qhat * vn[n - 1];
+      while (qhat >= b || qhat * vn[n - 2] > b * rhat + un[j + n - 2]) {
+        qhat--;
+        rhat += vn[n - 1];
+        if (rhat >= b) break;
+      }
+      int64_t k = 0, t;
+      for (unsigned i = 0; i < n; i++) {
+        uint64_t p = qhat * vn[i];
+        t = int64_t(un[i + j]) - k - int64_t(p & 0xFFFFFFFFu);
+        un[i + j] = uint32_t(t);
+        k = int64_t(p >> 32) - (t >> 32);
+      }
+      t = int64_t(un[j + n]) - k;
+      un[j + n] = uint32_t(t);
+      q[j] = uint32_t(qhat);
+      if (t < 0) {
+        q[j]--;
+        uint64_t c = 0;
+        for (unsigned i = 0; i < n; i++) {
+          uint64_t t2 = uint64_t(un[i + j]) + vn[i] + c;
+          un[i + j] = uint32_t(t2);
+          c = t2 >> 32;
+        }
+        un[j + n] = uint32_t(un[j + n] + c);
+      }
+    }
+    r.assign(n, 0);
+    for (unsigned i = 0; i + 1 < n; i++) {
+      r[i] = (un[i] >> s) | uint32_t(uint64_t(un[i + 1]) << (32 - s));
+    }
+    r[n - 1] = un[n - 1] >> s;
+  }
+
+  BigInt operator-() const {
+    BigInt res = *this;
+    if (!res.isZero()) res.negative = !negative;
+    return res;
+  }
+
+  BigInt operator+(const BigInt &other) const {
+    BigInt res;
+    if (negative == other.negative) {
+      res.mag = addMag(mag, other.mag);
+      res.negative = negative;
+    } else if (compareMag(mag, other.mag) >= 0) {
+      res.mag = subMag(mag, other.mag);
+      res.negative = negative;
+    } else {
+      res.mag = subMag(other.mag, mag);
+      res.negative = other.negative;
+    }
+    res.trim();
+    return res;
+  }
+
+  BigInt operator-(const BigInt &other) const { return *this + (-other); }
+
+  BigInt operator*(const BigInt &other) const {
+    BigInt res;
+    res.mag = mulMag(mag, other.mag);
+    res.negative = negative != other.negative;
+    res.trim();
+    return res;
+  }
+
+  // Truncating division, like the built-in integer types
+  static void divMod(const BigInt &a, const BigInt &b, BigInt &q, BigInt &r) {
+    assert(!b.isZero());
+    divModMag(a.mag, b.mag, q.mag, r.mag);
+    q.negative = a.negative != b.negative;
+    r.negative = a.negative;
+    q.trim();
+    r.trim();
+  }
+
+  int compare(const BigInt &other) const {
+    if (negative != other.negative) return negative ? -1 : 1;
+    int c = compareMag(mag, other.mag);
+    return negative ? -c : c;
+  }
+
+  std::string toString() const {
+    if (isZero()) return "0";
+    std::vector<uint32_t> cur = mag, q, r;
+    std::vector<uint32_t> chunk(1, 1000000000u);
+    std::string digits;
+    while (!cur.empty()) {
+      divModMag(cur, chunk, q, r);
+      while (!q.empty() && q.back() == 0) q.pop_back();
+      uint32_t rem = r.empty() ? 0 : r[0];
+      for (int i = 0; i < 9; i++) {
+        digits.push_back(char('0' + rem % 10));
+        rem /= 10;
+        if (q.empty() && rem == 0) break;
+      }
+      cur.swap(q);
+    }
+    if (negative) digits.push_back('-');
+    return std::string(digits.rbegin(), digits.rend());
+  }
+
+  // Parses an optionally signed decimal string, returns false on bad input
+  static bool fromString(const char *first, const char *last, BigInt &res) {
+    res = BigInt();
+    bool neg = false;
+    if (first != last && (*first == '-' || *first == '+')) {
+      neg = *first == '-';
+      first++;
+    }
+    if (first == last) return false;
+    for (; first != last; first++) {
+      if (*first < '0' || *first > '9') return false;
+      uint64_t carry = uint64_t(*first - '0');
+      for (auto &limb : res.mag) {
+        uint64_t t = uint64_t(limb) * 10 + carry;
+        limb = uint32_t(t);
+        carry = t >> 32;
+      }
+      if (carry != 0) res.mag.push_back(uint32_t(carry));
+    }
+    res.negative = neg;
+    res.trim();
+    return true;
+  }
+};
+
+/**
+ * Exact integer which stays in a machine word while the value allows it
+ *
+ * Small values are stored shifted left by one in a tagged int64_t (low bit 0),
+ * so additions and multiplications map directly onto checked machine
+ * arithmetic. On overflow the value moves to a heap allocated BigInt, whose
+ * pointer is stored with the low bit set. Results that fit again are brought
+ * back to the small representation.
+ */
+class Integer {
+ public:
+  static constexpr int64_t kMaxSmall = (int64_t(1) << 62) - 1;
+  static constexpr int64_t kMinSmall = -(int64_t(1) << 62);
+
+  Integer() : bits_(0) {}
+
+  template <class I, typename std::enable_if<std::is_integral<I>::value,
+                                             int>::type = 0>
+  Integer(I v) {
+    if (std::is_signed<I>::value) {
+      setWide(static_cast<__int128>(static_cast<int64_t>(v)));
+    } else {
+      setWide(static_cast<__int128>(static_cast<uint64_t>(v)));
+    }
+  }
+
+  // Truncates towards zero, like a cast to an integer type
+  explicit Integer(double d) : bits_(0) {
+    assert(std::isfinite(d));
+    d = std::trunc(d);
+    if (std::fabs(d) < 4611686018427387904.0) {
+      bits_ = tag(int64_t(d));
+      return;
+    }
+    int exp;
+    double m = std::frexp(std::fabs(d), &exp);
+    BigInt b(static_cast<__int128>(std::ldexp(m, 53)));
+    BigInt two(2);
+    for (int i = 53; i < exp; i++) b = b * two;
+    if (d < 0) b = -b;
+    setBig(std::move(b));
+  }
+
+  explicit Integer(BigInt b) : bits_(0) { setBig(std::move(b)); }
+
+  Integer(const Integer &other) : bits_(other.bits_) {
+    if (!other.isSmall()) bits_ = boxed(new BigInt(*other.big()));
+  }
+
+  Integer(Integer &&other) noexcept : bits_(other.bits_) { other.bits_ = 0; }
+
+  ~Integer() {
+    if (!isSmall()) delete big();
+  }
+
+  Integer &operator=(const Integer &other) {
+    if (this != &other) {
+      Integer tmp(other);
+      std::swap(bits_, tmp.bits_);
+    }
+    return *this;
+  }
+
+  Integer &operator=(Integer &&other) noexcept {
+    std::swap(bits_, other.bits_);
+    return *this;
+  }
+
+  bool isSmall() const { return (bits_ & 1) == 0; }
+
+  // Only meaningful when isSmall()
+  int64_t small() const { return bits_ >> 1; }
+
+  // Tagged word, exposed for kernels which work on rows of small values
+  int64_t bits() const { return bits_; }
+
+  BigInt toBig() const {
+    return isSmall() ? BigInt(static_cast<__int128>(small())) : *big();
+  }
+
+  double toDouble() const {
+    return isSmall() ? double(small()) : big()->toDouble();
+  }
+
+  int sign() const {
+    if (isSmall()) return (bits_ > 0) - (bits_ < 0);
+    return big()->negative ? -1 : 1;
+  }
+
+  Integer operator-() const {
+    int64_t r;
+    if (isSmall() && !__builtin_sub_overflow(int64_t(0), bits_, &r)) {
+      return fromBits(r);
+    }
+    return Integer(-toBig());
+  }
+
+  Integer operator+(const Integer &other) const {
+    int64_t r;
+    if (isSmall() && other.isSmall() &&
+        !__builtin_add_overflow(bits_, other.bits_, &r)) {
+      return fromBits(r);
+    }
+    return Integer(toBig() + other.toBig());
+  }
+
+  Integer operator-(const Integer &other) const {
+    int64_t r;
+    if (isSmall() && other.isSmall() &&
+        !__builtin_sub_overflow(bits_, other.bits_, &r)) {
+      return fromBits(r);
+    }
+    return Integer(toBig() - other.toBig());
+  }
+
+  Integer operator*(const Integer &other) const {
+    int64_t r;
+    if (isSmall() && other.isSmall() &&
+        !__builtin_mul_overflow(small(), other.bits_, &r)) {
+      return fromBits(r);
+    }
+    return Integer(toBig() * other.toBig());
+  }
+
+  Integer operator/(const Integer &other) const {
+    if (isSmall() && other.isSmall()) {
+      assert(other.bits_ != 0);
+      return Integer(small() / other.small());
+    }
+    BigInt q, r;
+    BigInt::divMod(toBig(), other.toBig(), q, r);
+    return Integer(std::move(q));
+  }
+
+  Integer operator%(const Integer &other) const {
+    if (isSmall() && other.isSmall()) {
+      assert(other.bits_ != 0);
+      return Integer(small() % other.small());
+    }
+    BigInt q, r;
+    BigInt::divMod(toBig(), other.toBig(), q, r);
+    return Integer(std::move(r));
+  }
+
+  Integer &operator+=(const Integer &other) { return *this = *this + other; }
+  Integer &operator-=(const Integer &other) { return *this = *this - other; }
+  Integer &operator*=(const Integer &other) { return *this = *this * other; }
+  Integer &operator/=(const Integer &other) { return *this = *this / other; }
+  Integer &operator%=(const Integer &other) { return *this = *this % other; }
+
+  int compare(const Integer &other) const {
+    if (isSmall() && other.isSmall()) {
+      return (bits_ > other.bits_) - (bits_ < other.bits_);
+    }
+    return toBig().compare(other.toBig());
+  }
+
+  friend bool operator==(const Integer &a, const Integer &b) {
+    if (a.isSmall() || b.isSmall()) return a.bits_ == b.bits_;
+    return a.compare(b) == 0;
+  }
+  friend bool operator!=(const Integer &a, const Integer &b) {
+    return !(a == b);
+  }
+  friend bool operator<(const Integer &a, const Integer &b) {
+    return a.compare(b) < 0;
+  }
+  friend bool operator<=(const Integer &a, const Integer &b) {
+    return a.compare(b) <= 0;
+  }
+  friend bool operator>(const Integer &a, const Integer &b) {
+    return a.compare(b) > 0;
+  }
+  friend bool operator>=(const Integer &a, const Integer &b) {
+    return a.compare(b) >= 0;
+  }
+
+  friend Integer gcd(const Integer &a, const Integer &b) {
+    if (a.isSmall() && b.isSmall()) {
+      return Integer(std::gcd(a.small(), b.small()));
+    }
+    BigInt x = a.toBig(), y = b.toBig(), q, r;
+    x.negative = y.negative = false;
+    while (!y.isZero()) {
+      BigInt::divMod(x, y, q, r);
+      x = std::move(y);
+      y = std::move(r);
+    }
+    return Integer(std::move(x));
+  }
+
+  friend Integer lcm(const Integer &a, const Integer &b) {
+    if (a.sign() == 0 || b.sign() == 0) return Integer();
+    Integer l = a / gcd(a, b) * b;
+    return l.sign() < 0 ? -l : l;
+  }
+
+  std::string toString() const {
+    return isSmall() ? std::to_string(small()) : big()->toString();
+  }
+
+  friend std::ostream &operator<<(std::ostream &out, const Integer &v) {
+    return out << v.toString();
+  }
+
+  friend std::istream &operator>>(std::istream &in, Integer &v) {
+    std::string token;
+    in >> std::ws;
+    if (in.peek() == '-' || in.peek() == '+') token.push_back(char(in.get()));
+    while (std::isdigit(in.peek())) token.push_back(char(in.get()));
+    BigInt b;
+    if (!BigInt::fromString(token.data(), token.data() + token.size(), b)) {
+      in.setstate(std::ios::failbit);
+      return in;
+    }
+    v = Integer(std::move(b));
+    return in;
+  }
+
+ private:
+  int64_t bits_;
+
+  static int64_t tag(int64_t v) { return int64_t(uint64_t(v) << 1); }
+
+  static Integer fromBits(int64_t bits) {
+    Integer res;
+    res.bits_ = bits;
+    return res;
+  }
+
+  static int64_t boxed(BigInt *b) {
+    return int64_t(reinterpret_cast<uintptr_t>(b) | 1);
+  }
+
+  BigInt *big() const {
+    return reinterpret_cast<BigInt *>(uintptr_t(bits_) & ~uintptr_t(1));
+  }
+
+  void setWide(__int128 v) {
+    if (v >= kMinSmall && v <= kMaxSmall) {
+      bits_ = tag(int64_t(v));
+    } else {
+      bits_ = boxed(new BigInt(v));
+    }
+  }
+
+  void setBig(BigInt b) {
+    int64_t v;
+    if (b.toInt64(v) && v >= kMinSmall && v <= kMaxSmall) {
+      bits_ = tag(v);
+    } else {
+      bits_ = boxed(new BigInt(std::move(b)));
+    }
+  }
+};
+
+/**
+ * Number helpers used by the templated code, so that it works both with the
+ * built-in integer types and with Integer
+ */
+/**
+ * Parses an optionally signed decimal integer spanning [first, last), returns
+ * false on bad input or if the value does not fit in T
+ */
+template <class T>
+bool parseInteger(const char *first, const char *last, T &v) {
+  if (first != last && *first == '+') first++;
+  auto res = std::from_chars(first, last, v);
+  return res.ec == std::errc() && res.ptr == last;
+}
+
+// Values beyond int64_t go through BigInt
+inline bool parseInteger(const char *first, const char *last, Integer &v) {
+  int64_t small;
+  if (parseInteger(first, last, small)) {
+    v = Integer(small);
+    return true;
+  }
+  BigInt b;
+  if (!BigInt::fromString(first, last, b)) return false;
+  v = Integer(std::move(b));
+  return true;
+}
+
+// Stores v in out if it fits in an int64_t
+template <class T>
+bool toInt64(const T &v, int64_t &out) {
+  out = static_cast<int64_t>(v);
+  return T(out) == v;
+}
+
+inline bool toInt64(const Integer &v, int64_t &out) {
+  if (v.isSmall()) {
+    out = v.small();
+    return true;
+  }
+  return v.toBig().toInt64(out);
+}
+
+template <class T>
+T gcd(const T &a, const T &b) {
+  return std::gcd(a, b);
+}
+
+template <class T>
+T lcm(const T &a, const T &b) {
+  return std::lcm(a, b);
+}
+
+template <class T>
+double toDouble(const T &v) {
+  return static_cast<double>(v);
+}
+
+inline double toDouble(const Integer &v) { return v.toDouble(); }
+
+// Hash of a value, equal values have equal hashes
+template <class T>
+uint64_t hashValue(const T &v) {
+  return uint64_t(v);
+}
+
+inline uint64_t hashValue(const Integer &v) {
+  if (v.isSmall()) return uint64_t(v.bits());
+  BigInt b = v.toBig();
+  uint64_t h = b.negative;
+  for (uint32_t limb : b.mag) h = h * 0x9e3779b97f4a7c15u + limb;
+  return h;
+}
+
+}  // namespace fm
+
+#endif  // UTVPI_OA_INTEGER_H
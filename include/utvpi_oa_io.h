@@ -0,0 +1,119 @@
+#if !defined(UTVPI_OA_IO_H)
+#define UTVPI_OA_IO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <utvpi_oa_integer.h>
+#include <utvpi_oa_rational.h>
+
+namespace fm {
+
+/**
+ * Contents of a file descriptor in memory: a read-only mapping when it is a
+ * regular file, and otherwise everything that can be read from it
+ */
+class InputBuffer {
+ public:
+  explicit InputBuffer(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 &&
+        lseek(fd, 0, SEEK_CUR) == 0) {
+      void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p != MAP_FAILED) {
+        mapped_ = static_cast<const char *>(p);
+        size_ = st.st_size;
+        return;
+      }
+    }
+    char chunk[1 << 16];
+    ssize_t n;
+    while ((n = ::read(fd, chunk, sizeof(chunk))) > 0) {
+      bytes_.insert(bytes_.end(), chunk, chunk + n);
+    }
+    size_ = bytes_.size();
+  }
+
+  ~InputBuffer() {
+    if (mapped_) munmap(const_cast<char *>(mapped_), size_);
+  }
+
+  InputBuffer(const InputBuffer &) = delete;
+  InputBuffer &operator=(const InputBuffer &) = delete;
+
+  const char *begin() const { return mapped_ ? mapped_ : bytes_.data(); }
+  const char *end() const { return begin() + size_; }
+
+ private:
+  const char *mapped_ = nullptr;
+  size_t size_ = 0;
+  std::vector<char> bytes_;
+};
+
+/**
+ * Whitespace separated tokens of a text buffer, parsed in place
+ */
+class TextScanner {
+ public:
+  TextScanner(const char *first, const char *last) : pos_(first), last_(last) {}
+
+  const char *position() const { return pos_; }
+
+  // Bytes left in the buffer, an upper bound on the tokens left
+  size_t remaining() const { return last_ - pos_; }
+
+  // Skips whitespace, returns true if nothing else is left
+  bool atEnd() {
+    while (pos_ != last_ && isSpace(*pos_)) pos_++;
+    return pos_ == last_;
+  }
+
+  // Next token, false at the end of the buffer
+  bool token(std::string_view &tok) {
+    if (atEnd()) return false;
+    const char *first = pos_;
+    while (pos_ != last_ && !isSpace(*pos_)) pos_++;
+    tok = std::string_view(first, pos_ - first);
+    return true;
+  }
+
+  template <class T>
+  bool readInteger(T &v) {
+    std::string_view tok;
+    return token(tok) && parseInteger(tok.data(), tok.data() + tok.size(), v);
+  }
+
+  template <class T>
+  bool readRational(Rational<T> &rat) {
+    std::string_view tok;
+    return token(tok) &&
+           Rational<T>::parse(tok.data(), tok.data() + tok.size(), rat);
+  }
+
+ private:
+  const char *pos_;
+  const char *last_;
+
+  static bool isSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\f' ||
+           c == '\v';
+  }
+};
+
+/**
+ * Binary format of a system: the magic bytes, nLines and nVars as uint32_t,
+ * then nLines rows of nVars + 1 int64_t (the coefficients a and the constant
+ * c of a * x >= c), all in native byte order
+ */
+constexpr char kBinaryMagic[8] = {'U', 'T', 'V', 'P', 'I', 'O', 'A', '1'};
+constexpr size_t kBinaryHeaderBytes = sizeof(kBinaryMagic) + 2 * 4;
+
+}  // namespace fm
+
+#endif  // UTVPI_OA_IO_H
@@ -0,0 +1,110 @@
+#if !defined(UTVPI_OA_KERNEL_H)
+#define UTVPI_OA_KERNEL_H
+
+#include <cstdint>
+#include <type_traits>
+
+#if defined(UTVPI_OA_WITH_SIMD) && defined(__x86_64__) && \
+    (defined(__GNUC__) || defined(__clang__))
+#define UTVPI_OA_AVX2_KERNEL
+#include <immintrin.h>
+#endif
+
+#include <utvpi_oa_integer.h>
+
+namespace fm {
+
+/**
+ * Row combination kernels of removeVar
+ *
+ * They work on the tagged words of rows of Integers. When every word of x
+ * and y is small and fits in an int32_t, and so do a and b, each product
+ * a * x[k] is below 2^62 in magnitude. The sum a * x[k] + b * y[k] then
+ * cannot overflow, and being even it is the tagged word of the result. The
+ * AVX2 kernel does four columns at a time with vpmuldq. It is built with
+ * UTVPI_OA_WITH_SIMD on x86-64 and picked at run time if the CPU has AVX2.
+ */
+namespace kernel {
+
+// res[0..n-1] = a * x + b * y on the words, returns the number of nonzeros
+using CombineFn = unsigned (*)(int64_t a, const int64_t *x, int64_t b,
+                               const int64_t *y, int64_t *res, unsigned n);
+
+// Whether the n words are all small Integers which fit in an int32_t
+inline bool narrow(const int64_t *x, unsigned n) {
+  for (unsigned k = 0; k < n; k++) {
+    if ((x[k] & 1) != 0 || uint64_t(x[k]) + 0x80000000u > 0xffffffffu) {
+      return false;
+    }
+  }
+  return true;
+}
+
+inline unsigned combineScalar(int64_t a, const int64_t *x, int64_t b,
+                              const int64_t *y, int64_t *res, unsigned n) {
+  unsigned nonzeros = 0;
+  for (unsigned k = 0; k < n; k++) {
+    res[k] = a * x[k] + b * y[k];
+    nonzeros += res[k] != 0;
+  }
+  return nonzeros;
+}
+
+#if defined(UTVPI_OA_AVX2_KERNEL)
+__attribute__((target("avx2"))) inline unsigned combineAvx2(
+    int64_t a, const int64_t *x, int64_t b, const int64_t *y, int64_t *res,
+    unsigned n) {
+  const __m256i va = _mm256_set1_epi64x(a), vb = _mm256_set1_epi64x(b);
+  const __m256i zero = _mm256_setzero_si256();
+  unsigned k = 0, zeros = 0;
+  for (; k + 4 <= n; k += 4) {
+    __m256i vx = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(x + k));
+    __m256i vy = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(y + k));
+    __m256i r = _mm256_add_epi64(_mm256_mul_epi32(va, vx),
+                                 _mm256_mul_epi32(vb, vy));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(res + k), r);
+    __m256d isZero = _mm256_castsi256_pd(_mm256_cmpeq_epi64(r, zero));
+    zeros += __builtin_popcount(_mm256_movemask_pd(isZero));
+  }
+  return (k - zeros) + combineScalar(a, x + k, b, y + k, res + k, n - k);
+}
+#endif
+
+// The fastest kernel the CPU supports
+inline CombineFn combineKernel() {
+  static const CombineFn fn = [] {
+#if defined(UTVPI_OA_AVX2_KERNEL)
+    if (__builtin_cpu_supports("avx2")) return &combineAvx2;
+#endif
+    return &combineScalar;
+  }();
+  return fn;
+}
+
+}  // namespace kernel
+
+// The tagged words of a row of T, for the types which have them
+template <class T>
+struct RowWords {
+  static constexpr bool kEnabled = false;
+};
+
+template <>
+struct RowWords<Integer> {
+  static_assert(sizeof(Integer) == sizeof(int64_t) &&
+                    std::is_standard_layout<Integer>::value,
+                "An Integer is one tagged word");
+  static constexpr bool kEnabled = true;
+
+  static const int64_t *get(const Integer *row) {
+    return reinterpret_cast<const int64_t *>(row);
+  }
+
+  // Only for rows of small values, which own no BigInt that a store of
+  // words could leak
+  static int64_t *get(Integer *row) { return reinterpret_cast<int64_t *>(row); }
+};
+
+}  // namespace fm
+
+#endif  // UTVPI_OA_KERNEL_H
@@ -0,0 +1,192 @@
+#if !defined(UTVPI_OA_LP_H)
+#define UTVPI_OA_LP_H
+
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#if defined(UTVPI_OA_WITH_CPLEX)
+#include <ilcplex/ilocplex.h>
+#endif
+
+#include <utvpi_oa_integer.h>
+#include <utvpi_oa_matrix.h>
+#include <utvpi_oa_rational.h>
+#include <utvpi_oa_simplex.h>
+
+namespace fm {
+
+/**
+ * LP backend used by LP0
+ *
+ * A backend is loaded with the rows a * x >= b of a system and then asked
+ * for the minimum of one objective after the other. Only the objective
+ * changes between the calls, so a backend is expected to warm-start each of
+ * them from the basis of the previous one. It may be loaded again with
+ * another system, which replaces the rows, so that one backend can serve a
+ * whole batch of systems.
+ */
+template <class T>
+class LPSolver {
+ public:
+  virtual ~LPSolver() = default;
+
+  // Loads the rows in place of any loaded before, and returns false if they
+  // are infeasible
+  virtual bool load(const Matrix<T> &lines, unsigned nVars) = 0;
+
+  // Minimizes sum c * x[var] over the (var, c) terms. Returns false if the
+  // minimum is unbounded, otherwise stores a lower bound on it in value.
+  virtual bool minimize(const std::vector<std::pair<unsigned, int>> &terms,
+                        Rational<T> &value) = 0;
+};
+
+// Creates a fresh backend, e.g. one per LP0 worker
+template <class T>
+using LPFactory = std::function<std::unique_ptr<LPSolver<T>>()>;
+
+template <class T, template <class> class Solver>
+LPFactory<T> solverFactory() {
+  return [] { return std::unique_ptr<LPSolver<T>>(new Solver<T>()); };
+}
+
+/**
+ * Idle LP backends, kept across systems so that a batch pays the setup of a
+ * backend, e.g. a CPLEX environment, once per backend rather than once per
+ * system. Every LP0 call takes one backend for each worker it runs on, loads
+ * it once with its system and gives it back when it is done, so the systems
+ * in flight on a pool never reload each other's backends.
+ */
+template <class T>
+class LPBackends {
+ public:
+  explicit LPBackends(LPFactory<T> factory) : factory_(std::move(factory)) {}
+
+  // An idle backend, or a new one if there is none
+  std::unique_ptr<LPSolver<T>> acquire() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!idle_.empty()) {
+        std::unique_ptr<LPSolver<T>> solver = std::move(idle_.back());
+        idle_.pop_back();
+        return solver;
+      }
+    }
+    return factory_();
+  }
+
+  void release(std::unique_ptr<LPSolver<T>> solver) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle_.push_back(std::move(solver));
+  }
+
+ private:
+  LPFactory<T> factory_;
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<LPSolver<T>>> idle_;
+};
+
+/**
+ * Built-in backend: the exact simplex of utvpi_oa_simplex.h, so the bounds are
+ * the exact minima
+ */
+template <class T>
+class SimplexSolver : public LPSolver<T> {
+ public:
+  bool load(const Matrix<T> &lines, unsigned nVars) override {
+    simplex_.reset(new Simplex<T>(lines, nVars));
+    return simplex_->feasible();
+  }
+
+  bool minimize(const std::vector<std::pair<unsigned, int>> &terms,
+                Rational<T> &value) override {
+    return simplex_->minimize(terms, value);
+  }
+
+ private:
+  std::unique_ptr<Simplex<T>> simplex_;
+};
+
+#if defined(UTVPI_OA_WITH_CPLEX)
+/**
+ * CPLEX backend. The model is extracted once per system, and every objective
+ * change is picked up incrementally, so CPLEX reuses the previous basis. The
+ * environment and the solver live as long as the backend, and a new system
+ * only replaces the variables and rows of the model. The optimum is a
+ * floating-point value, which is rounded down to a multiple of 2^-10.
+ */
+template <class T>
+class CplexSolver : public LPSolver<T> {
+ public:
+  CplexSolver()
+      : model_(env_),
+        vars_(env_),
+        rows_(env_),
+        obj_(IloMinimize(env_)),
+        cplex_(env_) {
+    model_.add(obj_);
+    cplex_.setOut(env_.getNullStream());
+  }
+
+  ~CplexSolver() override { env_.end(); }
+
+  bool load(const Matrix<T> &lines, unsigned nVars) override {
+    // Ending the variables also drops them from the objective
+    cplex_.clearModel();
+    model_.remove(rows_);
+    rows_.endElements();
+    rows_.clear();
+    vars_.endElements();
+    vars_.clear();
+    current_.clear();
+    for (unsigned j = 0; j < nVars; j++) {
+      vars_.add(IloNumVar(env_, -IloInfinity, IloInfinity));
+    }
+    for (auto line : lines) {
+      IloExpr expr(env_);
+      for (unsigned k = 0; k < nVars; k++) {
+        if (line[k] != T(0)) expr += toDouble(line[k]) * vars_[k];
+      }
+      rows_.add(expr >= toDouble(line[nVars]));
+      expr.end();
+    }
+    model_.add(rows_);
+    cplex_.extract(model_);
+    cplex_.solve();
+    return cplex_.getStatus() != IloAlgorithm::Infeasible;
+  }
+
+  bool minimize(const std::vector<std::pair<unsigned, int>> &terms,
+                Rational<T> &value) override {
+    for (auto &t : current_) obj_.setLinearCoef(vars_[t.first], 0);
+    for (auto &t : terms) obj_.setLinearCoef(vars_[t.first], t.second);
+    current_ = terms;
+    cplex_.solve();
+    if (cplex_.getStatus() != IloAlgorithm::Optimal) return false;
+    value = floorNum(cplex_.getObjValue());
+    return true;
+  }
+
+  static Rational<T> floorNum(double n, unsigned p = 10) {
+    T de = 1 << p;
+    T nu(std::floor(n * (1 << p)));
+    return Rational<T>(nu, de);
+  }
+
+ private:
+  IloEnv env_;
+  IloModel model_;
+  IloNumVarArray vars_;
+  IloRangeArray rows_;
+  IloObjective obj_;
+  IloCplex cplex_;
+  std::vector<std::pair<unsigned, int>> current_;
+};
+#endif  // UTVPI_OA_WITH_CPLEX
+
+}  // namespace fm
+
+#endif  // UTVPI_OA_LP_H
@@ -0,0 +1,259 @@
+#if !defined(UTVPI_OA_MATRIX_H)
+#define UTVPI_OA_MATRIX_H
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+#include <vector>
+
+namespace fm {
+
+/**
+ * Row-major matrix with a fixed stride, stored in one contiguous buffer
+ *
+ * Rows are addressed by pointer, so m[i][j] works as with nested vectors, and
+ * new rows are appended in place instead of being built separately and copied.
+ */
+template <class T>
+class Matrix {
+ public:
+  /**
+   * Non-owning view of one row
+   */
+  template <class V>
+  struct RowView {
+    V *ptr;
+    unsigned len;
+
+    V &operator[](unsigned j) const { return ptr[j]; }
+    V *begin() const { return ptr; }
+    V *end() const { return ptr + len; }
+    unsigned size() const { return len; }
+    V *data() const { return ptr; }
+  };
+
+  template <class V>
+  struct RowIterator {
+    V *ptr;
+    unsigned stride;
+
+    RowView<V> operator*() const { return RowView<V>{ptr, stride}; }
+    RowIterator &operator++() {
+      ptr += stride;
+      return *this;
+    }
+    bool operator!=(const RowIterator &other) const {
+      return ptr != other.ptr;
+    }
+  };
+
+  Matrix() = default;
+
+  explicit Matrix(unsigned nCols) : nCols_(nCols) {}
+
+  Matrix(unsigned nRows, unsigned nCols)
+      : nCols_(nCols), nRows_(nRows), data_(size_t(nRows) * nCols) {}
+
+  unsigned size() const { return nRows_; }
+  unsigned cols() const { return nCols_; }
+  bool empty() const { return nRows_ == 0; }
+
+  T *operator[](unsigned i) { return data_.data() + size_t(i) * nCols_; }
+  const T *operator[](unsigned i) const {
+    return data_.data() + size_t(i) * nCols_;
+  }
+
+  RowView<T> row(unsigned i) { return RowView<T>{(*this)[i], nCols_}; }
+  RowView<const T> row(unsigned i) const {
+    return RowView<const T>{(*this)[i], nCols_};
+  }
+
+  RowIterator<T> begin() { return RowIterator<T>{data_.data(), nCols_}; }
+  RowIterator<T> end() {
+    return RowIterator<T>{data_.data() + size_t(nRows_) * nCols_, nCols_};
+  }
+  RowIterator<const T> begin() const {
+    return RowIterator<const T>{data_.data(), nCols_};
+  }
+  RowIterator<const T> end() const {
+    return RowIterator<const T>{data_.data() + size_t(nRows_) * nCols_,
+                                nCols_};
+  }
+
+  // Sets the stride, only allowed while the matrix has no rows
+  void setCols(unsigned nCols) {
+    assert(nRows_ == 0);
+    nCols_ = nCols;
+  }
+
+  void reserve(unsigned nRows) { data_.reserve(size_t(nRows) * nCols_); }
+
+  void clear() {
+    data_.clear();
+    nRows_ = 0;
+  }
+
+  // Appends a zero row and returns a pointer to it
+  T *appendRow() {
+    data_.resize(data_.size() + nCols_);
+    return (*this)[nRows_++];
+  }
+
+  void pushRow(const T *row) {
+    T *dst = appendRow();
+    for (unsigned j = 0; j < nCols_; j++) dst[j] = row[j];
+  }
+
+  void pushRow(T *row) { pushRow(static_cast<const T *>(row)); }
+
+  template <class Row>
+  void pushRow(const Row &row) {
+    assert(row.size() == nCols_);
+    pushRow(row.data());
+  }
+
+  void popRow() {
+    assert(nRows_ > 0);
+    nRows_--;
+    data_.resize(size_t(nRows_) * nCols_);
+  }
+
+  void eraseRow(unsigned i) {
+    assert(i < nRows_);
+    data_.erase(data_.begin() + size_t(i) * nCols_,
+                data_.begin() + size_t(i + 1) * nCols_);
+    nRows_--;
+  }
+
+  // Keeps only the rows for which keep[i] is set, in one compaction pass
+  void compactRows(const std::vector<bool> &keep) {
+    assert(keep.size() == nRows_);
+    unsigned out = 0;
+    for (unsigned i = 0; i < nRows_; i++) {
+      if (!keep[i]) continue;
+      if (out != i) {
+        T *dst = (*this)[out];
+        T *src = (*this)[i];
+        for (unsigned j = 0; j < nCols_; j++) dst[j] = std::move(src[j]);
+      }
+      out++;
+    }
+    nRows_ = out;
+    data_.resize(size_t(nRows_) * nCols_);
+  }
+
+ private:
+  unsigned nCols_ = 0;
+  unsigned nRows_ = 0;
+  std::vector<T> data_;
+};
+
+/**
+ * Row-major sparse matrix in compressed row form
+ *
+ * Every row is a run of (column, value) pairs sorted by column, holding its
+ * nonzero entries only. Rows are appended whole and can be dropped in place,
+ * which is all the elimination needs.
+ */
+template <class T>
+class SparseMatrix {
+ public:
+  /**
+   * Non-owning view of one row
+   */
+  struct Row {
+    const unsigned *index;
+    const T *value;
+    unsigned nnz;
+
+    // Entry in column col, zero if it is not stored
+    T operator[](unsigned col) const {
+      const unsigned *it = std::lower_bound(index, index + nnz, col);
+      if (it == index + nnz || *it != col) return T(0);
+      return value[it - index];
+    }
+  };
+
+  SparseMatrix() = default;
+
+  explicit SparseMatrix(unsigned nCols) : nCols_(nCols) {}
+
+  unsigned size() const { return start_.size() - 1; }
+  unsigned cols() const { return nCols_; }
+  bool empty() const { return size() == 0; }
+  size_t nonzeros() const { return index_.size(); }
+
+  Row operator[](unsigned i) const {
+    return Row{index_.data() + start_[i], value_.data() + start_[i],
+               start_[i + 1] - start_[i]};
+  }
+
+  // Sets the number of columns, only allowed while the matrix has no rows
+  void setCols(unsigned nCols) {
+    assert(empty());
+    nCols_ = nCols;
+  }
+
+  void reserve(unsigned nRows, size_t nnz) {
+    start_.reserve(nRows + 1);
+    index_.reserve(nnz);
+    value_.reserve(nnz);
+  }
+
+  void pushRow(const unsigned *index, const T *value, unsigned nnz) {
+    for (unsigned k = 0; k < nnz; k++) {
+      assert(index[k] < nCols_ && (k == 0 || index[k - 1] < index[k]));
+      index_.push_back(index[k]);
+      value_.push_back(value[k]);
+    }
+    start_.push_back(index_.size());
+  }
+
+  // Appends the nonzero entries of a dense row
+  void pushDense(const T *row) {
+    for (unsigned k = 0; k < nCols_; k++) {
+      if (row[k] == T(0)) continue;
+      index_.push_back(k);
+      value_.push_back(row[k]);
+    }
+    start_.push_back(index_.size());
+  }
+
+  // Writes row i to a dense buffer of cols() entries
+  void toDense(unsigned i, T *out) const {
+    for (unsigned k = 0; k < nCols_; k++) out[k] = T(0);
+    for (unsigned p = start_[i]; p < start_[i + 1]; p++) {
+      out[index_[p]] = value_[p];
+    }
+  }
+
+  // Keeps only the rows for which keep[i] is set, in one compaction pass
+  void compactRows(const std::vector<bool> &keep) {
+    assert(keep.size() == size());
+    unsigned out = 0;
+    size_t nnz = 0;
+    for (unsigned i = 0; i < size(); i++) {
+      if (!keep[i]) continue;
+      for (unsigned p = start_[i]; p < start_[i + 1]; p++, nnz++) {
+        if (nnz == p) continue;
+        index_[nnz] = index_[p];
+        value_[nnz] = std::move(value_[p]);
+      }
+      start_[++out] = nnz;
+    }
+    start_.resize(out + 1);
+    index_.resize(nnz);
+    value_.resize(nnz);
+  }
+
+ private:
+  unsigned nCols_ = 0;
+  // Row i is stored in [start_[i], start_[i + 1]) of index_ and value_
+  std::vector<unsigned> start_{0};
+  std::vector<unsigned> index_;
+  std::vector<T> value_;
+};
+
+}  // namespace fm
+
+#endif  // UTVPI_OA_MATRIX_H
@@ -0,0 +1,277 @@
+#if !defined(UTVPI_OA_OCTAGON_H)
+#define UTVPI_OA_OCTAGON_H
+
+#include <cassert>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <utvpi_oa_rational.h>
+
+namespace fm {
+
+/**
+ * Octagon over n variables, stored as a difference bound matrix over the 2n
+ * signed variables +x_k (node 2k) and -x_k (node 2k + 1)
+ *
+ * Entry (i, j) bounds v_j - v_i from above, and is absent if there is no such
+ * bound. Every UTVPI constraint is stored twice, in (i, j) and in its coherent
+ * entry (j ^ 1, i ^ 1). Bounds are rational, so the closure is the tightest
+ * octagon containing the constraints, and every bound of a closed octagon is
+ * the exact minimum of its direction.
+ *
+ * The matrix is stored row by row, so the closures sweep whole rows: row i
+ * becomes min(row i, m(i, k) + row k). Bounds are looked up in O(1).
+ */
+template <class T>
+class Octagon {
+ public:
+  using Terms = std::vector<std::pair<unsigned, int>>;
+
+  explicit Octagon(unsigned nVars)
+      : n_(2 * nVars), m_(n_ * n_), finite_(n_ * n_, false) {
+    for (unsigned i = 0; i < n_; i++) finite_[i * n_ + i] = true;
+  }
+
+  unsigned nVars() const { return n_ / 2; }
+
+  // Bound of v_j - v_i, false if there is none
+  bool bound(unsigned i, unsigned j, Rational<T> &c) const {
+    if (!finite(i, j)) return false;
+    c = at(i, j);
+    return true;
+  }
+
+  // Adds the constraint sum(terms) >= bound for one or two (var, +-1) terms
+  void addBound(const Terms &terms, const Rational<T> &bound) {
+    unsigned i, j;
+    Rational<T> c = entry(terms, bound, i, j);
+    tighten(i, j, c);
+  }
+
+  // Shortest-path closure followed by one strengthening step, which is the
+  // strong closure for rational bounds. Returns false if the octagon is empty.
+  bool close() {
+    for (unsigned k = 0; k < n_; k++) {
+      // Row k only changes through m(k, k) < 0, which strengthen reports
+      const Rational<T> *rowK = &m_[k * n_];
+      const char *finK = &finite_[k * n_];
+      for (unsigned i = 0; i < n_; i++) {
+        if (i != k && finite(i, k)) sweep(i, at(i, k), rowK, finK);
+      }
+    }
+    return strengthen();
+  }
+
+  // Adds sum(terms) >= bound to a closed octagon and closes it again, in
+  // O(n^2). Returns false if the octagon becomes empty.
+  bool addBoundAndClose(const Terms &terms, const Rational<T> &bound) {
+    unsigned i, j;
+    Rational<T> c = entry(terms, bound, i, j);
+    if (finite(i, j) && !(c < at(i, j))) return true;
+    // A shortest path uses the constraint i -> j and its coherent copy
+    // (j ^ 1) -> (i ^ 1) at most once each, so it ends with a path of the
+    // old octagon from j or from cj = i ^ 1. Those two rows are kept as they
+    // were; the other entries are only read through tighter paths, so they
+    // are updated in place.
+    unsigned ci = j ^ 1, cj = i ^ 1;
+    std::vector<Rational<T>> rowJ(&m_[j * n_], &m_[j * n_] + n_);
+    std::vector<Rational<T>> rowCJ(&m_[cj * n_], &m_[cj * n_] + n_);
+    std::vector<char> finJ(&finite_[j * n_], &finite_[j * n_] + n_);
+    std::vector<char> finCJ(&finite_[cj * n_], &finite_[cj * n_] + n_);
+    for (unsigned a = 0; a < n_; a++) {
+      // Shortest prefixes from a up to the start of each row
+      bool toJ = false, toCJ = false;
+      Rational<T> dJ, dCJ;
+      auto path = [&](bool &found, Rational<T> &best, const Rational<T> &v) {
+        if (!found || v < best) best = v;
+        found = true;
+      };
+      if (finite(a, i)) {
+        path(toJ, dJ, at(a, i) + c);
+        if (finJ[ci]) path(toCJ, dCJ, at(a, i) + c + rowJ[ci] + c);
+      }
+      if (finite(a, ci)) {
+        path(toCJ, dCJ, at(a, ci) + c);
+        if (finCJ[i]) path(toJ, dJ, at(a, ci) + c + rowCJ[i] + c);
+      }
+      if (toJ) sweep(a, dJ, rowJ.data(), finJ.data());
+      if (toCJ) sweep(a, dCJ, rowCJ.data(), finCJ.data());
+    }
+    return strengthen();
+  }
+
+  // Lower bound of sum(terms), false if the direction is unbounded
+  bool lowerBound(const Terms &terms, Rational<T> &bound) const {
+    unsigned i, j;
+    entry(terms, Rational<T>(0), i, j);
+    if (!finite(i, j)) return false;
+    bound = terms.size() == 1 ? -at(i, j) / Rational<T>(2) : -at(i, j);
+    return true;
+  }
+
+  // A point of this closed, non-empty octagon on which sum(terms) reaches
+  // its lower bound. Every variable is fixed in turn to its lower bound, or
+  // to its upper bound if it has no lower one.
+  std::vector<Rational<T>> minimizer(const Terms &terms) const {
+    Octagon<T> o = *this;
+    Rational<T> bound;
+    if (lowerBound(terms, bound)) {
+      Terms neg = terms;
+      for (auto &t : neg) t.second = -t.second;
+      o.addBoundAndClose(neg, -bound);
+    }
+    std::vector<Rational<T>> x(nVars());
+    for (unsigned k = 0; k < nVars(); k++) {
+      Rational<T> lo, negHi;
+      if (o.lowerBound({{k, 1}}, lo)) {
+        x[k] = lo;
+      } else if (o.lowerBound({{k, -1}}, negHi)) {
+        x[k] = -negHi;
+      }
+      o.addBoundAndClose({{k, 1}}, x[k]);
+      o.addBoundAndClose({{k, -1}}, -x[k]);
+    }
+    return x;
+  }
+
+  // The bounds of this closed octagon as the rows "1 a c" of a * x + c >= 0,
+  // one per direction with a bound, unary ones first and then the pairs
+  // (i, j) with i < j in the sign patterns (+, +), (-, -), (+, -), (-, +).
+  // Every constraint is printed once and tight, so equal octagons print the
+  // same.
+  void print(std::ostream &out, const std::vector<std::string> &labels) const {
+    std::vector<Terms> dirs;
+    for (unsigned k = 0; k < nVars(); k++) {
+      dirs.push_back({{k, 1}});
+      dirs.push_back({{k, -1}});
+    }
+    for (unsigned a = 0; a < nVars(); a++) {
+      for (unsigned b = a + 1; b < nVars(); b++) {
+        for (auto signs : {std::make_pair(1, 1), std::make_pair(-1, -1),
+                           std::make_pair(1, -1), std::make_pair(-1, 1)}) {
+          dirs.push_back({{a, signs.first}, {b, signs.second}});
+        }
+      }
+    }
+    bool header = false;
+    std::vector<int> row(nVars());
+    for (const Terms &terms : dirs) {
+      Rational<T> lo;
+      if (!lowerBound(terms, lo)) continue;
+      if (!header) {
+        for (auto &label : labels) out << " " << label;
+        out << " c" << std::endl;
+        header = true;
+      }
+      std::fill(row.begin(), row.end(), 0);
+      for (auto &t : terms) row[t.first] = t.second;
+      out << 1;
+      for (int a : row) out << " " << a;
+      out << " ";
+      (-lo).print(out);
+      out << std::endl;
+    }
+  }
+
+  // The matrix itself: a header of the 2n signed variables, then every row
+  // i as its signed variable and the bounds of v_j - v_i, "inf" if absent
+  void printMatrix(std::ostream &out,
+                   const std::vector<std::string> &labels) const {
+    auto name = [&](unsigned v) {
+      return (v % 2 ? "-" : "+") + labels[v / 2];
+    };
+    for (unsigned j = 0; j < n_; j++) out << " " << name(j);
+    out << std::endl;
+    for (unsigned i = 0; i < n_; i++) {
+      out << name(i);
+      for (unsigned j = 0; j < n_; j++) {
+        out << " ";
+        if (finite(i, j))
+          at(i, j).print(out);
+        else
+          out << "inf";
+      }
+      out << std::endl;
+    }
+  }
+
+ private:
+  unsigned n_;
+  std::vector<Rational<T>> m_;
+  std::vector<char> finite_;
+
+  static unsigned node(unsigned var, int sign) {
+    return 2 * var + (sign > 0 ? 0 : 1);
+  }
+
+  bool finite(unsigned i, unsigned j) const { return finite_[i * n_ + j]; }
+
+  const Rational<T> &at(unsigned i, unsigned j) const { return m_[i * n_ + j]; }
+
+  // Entry (i, j) and its bound for sum(terms) >= bound, which is
+  // -(sum(terms)) <= -bound
+  static Rational<T> entry(const Terms &terms, const Rational<T> &bound,
+                           unsigned &i, unsigned &j) {
+    assert(terms.size() == 1 || terms.size() == 2);
+    if (terms.size() == 1) {
+      i = node(terms[0].first, terms[0].second);
+      j = i ^ 1;
+      return -bound * Rational<T>(2);
+    }
+    i = node(terms[1].first, terms[1].second);
+    j = node(terms[0].first, -terms[0].second);
+    return -bound;
+  }
+
+  void relax(unsigned i, unsigned j, const Rational<T> &c) {
+    unsigned e = i * n_ + j;
+    if (finite_[e] && !(c < m_[e])) return;
+    finite_[e] = true;
+    m_[e] = c;
+  }
+
+  // Row i = min(row i, ik + row k), where row k may be a copy
+  void sweep(unsigned i, const Rational<T> &ik, const Rational<T> *rowK,
+             const char *finK) {
+    // ik may be an entry of row i
+    Rational<T> d = ik;
+    Rational<T> *rowI = &m_[i * n_];
+    char *finI = &finite_[i * n_];
+    for (unsigned j = 0; j < n_; j++) {
+      if (!finK[j]) continue;
+      Rational<T> c = d + rowK[j];
+      if (!finI[j] || c < rowI[j]) {
+        rowI[j] = c;
+        finI[j] = true;
+      }
+    }
+  }
+
+  void tighten(unsigned i, unsigned j, const Rational<T> &c) {
+    relax(i, j, c);
+    relax(j ^ 1, i ^ 1, c);
+  }
+
+  // v_j - v_i <= (v_{i^1} - v_i + v_j - v_{j^1}) / 2
+  bool strengthen() {
+    for (unsigned i = 0; i < n_; i++) {
+      if (!finite(i, i ^ 1)) continue;
+      for (unsigned j = 0; j < n_; j++) {
+        if (finite(j ^ 1, j)) {
+          relax(i, j, (at(i, i ^ 1) + at(j ^ 1, j)) / Rational<T>(2));
+        }
+      }
+    }
+    for (unsigned i = 0; i < n_; i++) {
+      if (at(i, i) < T(0)) return false;
+      m_[i * n_ + i] = Rational<T>(0);
+    }
+    return true;
+  }
+};
+
+}  // namespace fm
+
+#endif  // UTVPI_OA_OCTAGON_H
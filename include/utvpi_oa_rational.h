@@ -0,0 +1,185 @@
+#if !defined(UTVPI_OA_RATIONAL_H)
+#define UTVPI_OA_RATIONAL_H
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <string>
+
+#include <utvpi_oa_integer.h>
+#include <utvpi_oa_stats.h>
+
+namespace fm {
+
+/**
+ * Rational number
+ */
+template <class T>
+struct Rational {
+  T numerator;
+  T denominator;
+
+  Rational(T n = 0, T d = 1) {
+    numerator = n;
+    denominator = d;
+    simplify();
+  }
+
+  // Copies are already in lowest terms
+  Rational(const Rational<T> &r)
+      : numerator(r.numerator), denominator(r.denominator) {}
+
+  void simplify() {
+    if (denominator == 0) {
+      assert(false);
+    }
+    if (numerator == 0) {
+      denominator = 1;
+    }
+    if (denominator < 0) {
+      numerator = -numerator;
+      denominator = -denominator;
+    }
+    T g = gcd(numerator, denominator);
+    addStat(Counter::Gcd);
+    numerator /= g;
+    denominator /= g;
+  }
+
+  // Parses p or p/q spanning [first, last), returns false on bad input
+  static bool parse(const char *first, const char *last, Rational<T> &rat) {
+    const char *slash = std::find(first, last, '/');
+    if (!parseInteger(first, slash, rat.numerator)) return false;
+    rat.denominator = T(1);
+    if (slash == last) return true;
+    if (!parseInteger(slash + 1, last, rat.denominator)) return false;
+    if (rat.denominator == T(0)) return false;
+    rat.simplify();
+    return true;
+  }
+
+  static Rational<T> read(std::istream &in) {
+    Rational<T> rat(0, 1);
+    std::string input;
+    in >> input;
+    if (!parse(input.data(), input.data() + input.size(), rat)) {
+      in.setstate(std::ios::failbit);
+    }
+    return rat;
+  }
+
+  void print(std::ostream &out) const {
+    out << numerator;
+    if (denominator != 1) {
+      out << "/" << denominator;
+    }
+  }
+
+  Rational<T> operator-() const {
+    Rational<T> rat(-numerator, denominator);
+    return rat;
+  }
+
+  Rational<T> operator=(const Rational<T> &other) {
+    numerator = other.numerator;
+    denominator = other.denominator;
+    return *this;
+  }
+
+  Rational<T> operator+(const Rational<T> &other) const {
+    Rational<T> rat(0, 1);
+    if (denominator == T(1) && other.denominator == T(1)) {
+      rat.numerator = numerator + other.numerator;
+      return rat;
+    }
+    T l = lcm(denominator, other.denominator);
+    addStat(Counter::Lcm);
+    rat.denominator = l;
+    rat.numerator = numerator * (l / denominator) +
+                    other.numerator * (l / other.denominator);
+    T g = gcd(rat.numerator, rat.denominator);
+    addStat(Counter::Gcd);
+    rat.numerator /= g;
+    rat.denominator /= g;
+    return rat;
+  }
+
+  Rational<T> operator-(const Rational<T> &other) const {
+    return *this + (-other);
+  }
+
+  Rational<T> reciprocal() const {
+    Rational<T> rat(denominator, numerator);
+    return rat;
+  }
+
+  Rational<T> operator*(const Rational<T> &other) const {
+    if (denominator == T(1) && other.denominator == T(1)) {
+      Rational<T> rat(0, 1);
+      rat.numerator = numerator * other.numerator;
+      return rat;
+    }
+    Rational<T> rat(numerator * other.numerator,
+                    denominator * other.denominator);
+    T g = gcd(rat.numerator, rat.denominator);
+    addStat(Counter::Gcd);
+    rat.numerator /= g;
+    rat.denominator /= g;
+    return rat;
+  }
+
+  Rational<T> operator/(const Rational<T> &other) const {
+    return *this * other.reciprocal();
+  }
+
+  bool operator==(const Rational<T> &other) const {
+    return numerator * other.denominator == other.numerator * denominator;
+  }
+
+  bool operator==(const T &other) const { return *this == Rational(other, 1); }
+
+  bool operator!=(const Rational<T> &other) const { return !(*this == other); }
+
+  bool operator!=(const T &other) const { return !(*this == other); }
+
+  bool operator<=(const Rational<T> &other) const {
+    if (denominator > 0 && other.denominator > 0)
+      return numerator * other.denominator <= other.numerator * denominator;
+    else {
+      assert(false);
+    }
+  }
+
+  bool operator<=(const T &other) const { return *this <= Rational(other, 1); }
+
+  bool operator<(const Rational<T> &other) const {
+    if (denominator > 0 && other.denominator > 0)
+      return numerator * other.denominator < other.numerator * denominator;
+    assert(false);
+    return false;
+  }
+
+  bool operator<(const T &other) const { return *this < Rational(other, 1); }
+
+  bool operator>=(const Rational<T> &other) const {
+    if (denominator > 0 && other.denominator > 0)
+      return numerator * other.denominator >= other.numerator * denominator;
+    assert(false);
+    return false;
+  }
+
+  bool operator>=(const T &other) const { return *this >= Rational(other, 1); }
+
+  bool operator>(const Rational<T> &other) const {
+    if (denominator > 0 && other.denominator > 0)
+      return numerator * other.denominator > other.numerator * denominator;
+    assert(false);
+    return false;
+  }
+
+  bool operator>(const T &other) const { return *this > Rational(other, 1); }
+};
+
+}  // namespace fm
+
+#endif  // UTVPI_OA_RATIONAL_H
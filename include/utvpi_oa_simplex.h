@@ -0,0 +1,433 @@
+#if !defined(UTVPI_OA_SIMPLEX_H)
+#define UTVPI_OA_SIMPLEX_H
+
+#include <cassert>
+#include <utility>
+#include <vector>
+
+#include <utvpi_oa_matrix.h>
+#include <utvpi_oa_rational.h>
+
+namespace fm {
+
+/**
+ * Primal simplex over the rows a * x >= b of a system
+ *
+ * The tableau is kept in dictionary form, with one row per constraint giving
+ * its basic variable in terms of the nonbasic ones. The variables x are free
+ * and are pivoted into the basis once, after which only the slacks of the
+ * constraints (s_r = a_r * x - b_r >= 0) take part in ratio tests. The basis
+ * is kept feasible between calls, so every query warm-starts from the basis
+ * left by the previous one. Bland's rule is used throughout, so no query can
+ * cycle.
+ *
+ * The tableau holds exact rationals by default. With V = Approx it holds
+ * doubles compared with a tolerance, for the floating-point FM engine, which
+ * only uses it to drop rows.
+ */
+template <class T, class V = Rational<T>>
+class Simplex {
+ public:
+  enum Outcome { Optimal, Unbounded, Violated };
+
+  Simplex(const Matrix<T> &lines, unsigned nVars)
+      : n_(nVars),
+        m_(lines.size()),
+        cols_(nVars + 1),
+        coef_(lines.size(), nVars + 1),
+        beta_(lines.size()),
+        basic_(lines.size()),
+        nonbasic_(nVars + 1),
+        alive_(lines.size(), true),
+        deadCol_(nVars + 1, false),
+        rowOf_(nVars + lines.size() + 1, -1),
+        colOf_(nVars + lines.size() + 1, -1),
+        objCoef_(nVars + 1) {
+    for (unsigned r = 0; r < m_; r++) {
+      for (unsigned k = 0; k < n_; k++) {
+        coef_[r][k] = V(lines[r][k]);
+      }
+      beta_[r] = V(-lines[r][n_]);
+      basic_[r] = n_ + r;
+      rowOf_[n_ + r] = r;
+    }
+    for (unsigned k = 0; k < cols_; k++) {
+      nonbasic_[k] = k < n_ ? k : aux();
+      colOf_[nonbasic_[k]] = k;
+    }
+    deadCol_[n_] = true;
+    pivotFreeVariables();
+    feasible_ = phase1();
+  }
+
+  bool feasible() const { return feasible_; }
+
+  /**
+   * Checks whether row i is implied by the other remaining rows, i.e.
+   * whether min a_i * x over them is at least b_i. A redundant row is dropped
+   * from the tableau, so later checks are made against the remaining rows.
+   */
+  bool removeIfRedundant(unsigned i) {
+    if (!isRedundant(i)) return false;
+    unsigned v = n_ + i;
+    if (rowOf_[v] >= 0) killRow(rowOf_[v]);
+    return true;
+  }
+
+  /**
+   * Same check as removeIfRedundant, but the row is kept in the tableau
+   */
+  bool isRedundant(unsigned i) {
+    assert(feasible_);
+    unsigned v = n_ + i;
+    if (rowOf_[v] < 0 && colOf_[v] < 0) return true;
+    setObjective(v);
+    if (optimize(int(v)) != Optimal) return false;
+    assert(rowOf_[v] >= 0);
+    return true;
+  }
+
+  /**
+   * Minimizes sum c * x[var] over the (var, c) terms and the remaining rows.
+   * Returns false if the minimum is unbounded, otherwise stores it in value.
+   */
+  bool minimize(const std::vector<std::pair<unsigned, int>> &terms,
+                V &value) {
+    assert(feasible_);
+    clearObjective();
+    for (auto &t : terms) addObjective(t.first, V(t.second));
+    if (optimize() != Optimal) return false;
+    value = objBeta_;
+    return true;
+  }
+
+  /**
+   * The point of the current basis, e.g. the minimizer found by the last
+   * call of minimize
+   */
+  std::vector<V> point() const {
+    std::vector<V> x(n_);
+    for (unsigned k = 0; k < n_; k++) {
+      if (rowOf_[k] >= 0) x[k] = beta_[rowOf_[k]];
+    }
+    return x;
+  }
+
+  /**
+   * After a call of minimize found no minimum: a ray of the rows along
+   * which the objective decreases without bound
+   */
+  std::vector<V> ray() const {
+    std::vector<V> r(n_);
+    V dir(rayDir_);
+    for (unsigned k = 0; k < n_; k++) {
+      if (rowOf_[k] >= 0)
+        r[k] = coef_[rowOf_[k]][rayCol_] * dir;
+      else if (colOf_[k] == int(rayCol_))
+        r[k] = dir;
+    }
+    return r;
+  }
+
+  /**
+   * Adds the row line[0..n-1] * x >= line[n] to a feasible tableau. If the
+   * current point violates it, its slack is maximized, starting from the
+   * current basis, until the slack can leave the basis at zero. Returns false
+   * if the rows became infeasible, after which the tableau can no longer be
+   * queried.
+   */
+  bool addRow(const T *line) {
+    assert(feasible_);
+    // The auxiliary variable of phase 1 takes no further part, so the new
+    // slack takes its index and the auxiliary variable moves after it
+    unsigned slack = aux();
+    m_++;
+    rowOf_.push_back(-1);
+    colOf_.push_back(-1);
+    std::swap(rowOf_[slack], rowOf_[aux()]);
+    std::swap(colOf_[slack], colOf_[aux()]);
+    for (auto &v : basic_) {
+      if (v == slack) v = aux();
+    }
+    for (auto &v : nonbasic_) {
+      if (v == slack) v = aux();
+    }
+
+    // The new slack a * x - b, in terms of the nonbasic variables
+    unsigned r = m_ - 1;
+    V *row = coef_.appendRow();
+    beta_.push_back(V(-line[n_]));
+    for (unsigned k = 0; k < n_; k++) {
+      if (line[k] == T(0)) continue;
+      V a(line[k]);
+      if (rowOf_[k] >= 0) {
+        unsigned s = rowOf_[k];
+        beta_[r] = beta_[r] + a * beta_[s];
+        for (unsigned j = 0; j < cols_; j++) {
+          if (coef_[s][j] != T(0)) row[j] = row[j] + a * coef_[s][j];
+        }
+      } else {
+        row[colOf_[k]] = row[colOf_[k]] + a;
+      }
+    }
+    basic_.push_back(slack);
+    alive_.push_back(true);
+    rowOf_[slack] = r;
+    feasible_ = restore(r);
+    return feasible_;
+  }
+
+ private:
+  unsigned n_, m_, cols_;
+  Matrix<V> coef_;
+  std::vector<V> beta_;
+  std::vector<unsigned> basic_, nonbasic_;
+  std::vector<bool> alive_, deadCol_;
+  std::vector<int> rowOf_, colOf_;
+  // Objective being minimized: objBeta_ + objCoef_ * nonbasic
+  V objBeta_;
+  std::vector<V> objCoef_;
+  bool feasible_ = false;
+  // Column and direction of the last unbounded move of optimize
+  unsigned rayCol_ = 0;
+  int rayDir_ = 1;
+
+  unsigned aux() const { return n_ + m_; }
+
+  bool isFree(unsigned var) const { return var < n_; }
+
+  void killRow(unsigned r) {
+    alive_[r] = false;
+    rowOf_[basic_[r]] = -1;
+  }
+
+  // Exchanges the basic variable of row r with the nonbasic variable of
+  // column k
+  void pivot(unsigned r, unsigned k) {
+    V inv = coef_[r][k].reciprocal();
+    V negInv = -inv;
+    V *row = coef_[r];
+    beta_[r] = beta_[r] * negInv;
+    for (unsigned j = 0; j < cols_; j++) {
+      if (j == k || row[j] == T(0)) continue;
+      row[j] = row[j] * negInv;
+    }
+    row[k] = inv;
+    for (unsigned s = 0; s < m_; s++) {
+      if (s == r || !alive_[s] || coef_[s][k] == T(0)) continue;
+      eliminate(coef_[s], beta_[s], row, beta_[r], k);
+    }
+    if (objCoef_[k] != T(0)) {
+      eliminate(objCoef_.data(), objBeta_, row, beta_[r], k);
+    }
+    unsigned entering = nonbasic_[k], leaving = basic_[r];
+    basic_[r] = entering;
+    nonbasic_[k] = leaving;
+    rowOf_[entering] = r;
+    colOf_[entering] = -1;
+    rowOf_[leaving] = -1;
+    colOf_[leaving] = k;
+  }
+
+  // Substitutes the pivot row (solved for column k) into a row
+  void eliminate(V *dst, V &dstBeta,
+                 const V *row, const V &rowBeta,
+                 unsigned k) {
+    V c = dst[k];
+    dstBeta = dstBeta + c * rowBeta;
+    for (unsigned j = 0; j < cols_; j++) {
+      if (j == k || row[j] == T(0)) continue;
+      dst[j] = dst[j] + c * row[j];
+    }
+    dst[k] = c * row[k];
+  }
+
+  // Moves every free variable into the basis, using any constraint row in
+  // which it occurs
+  void pivotFreeVariables() {
+    for (unsigned k = 0; k < n_; k++) {
+      assert(isFree(nonbasic_[k]));
+      for (unsigned r = 0; r < m_; r++) {
+        if (!isFree(basic_[r]) && coef_[r][k] != T(0)) {
+          pivot(r, k);
+          break;
+        }
+      }
+    }
+  }
+
+  bool constrained(unsigned r) const {
+    return alive_[r] && !isFree(basic_[r]);
+  }
+
+  // Finds the constraint row which first blocks column k moving in direction
+  // dir, ignoring the row of skipVar. Returns -1 if no row blocks.
+  int ratioTest(unsigned k, int dir, int skipVar, V &step) {
+    int best = -1;
+    for (unsigned r = 0; r < m_; r++) {
+      if (!constrained(r) || int(basic_[r]) == skipVar) continue;
+      V d = coef_[r][k];
+      if (dir < 0) d = -d;
+      if (d >= T(0)) continue;
+      V t = beta_[r] / (-d);
+      if (best < 0 || t < step ||
+          (t == step && basic_[r] < basic_[best])) {
+        best = r;
+        step = t;
+      }
+    }
+    return best;
+  }
+
+  void clearObjective() {
+    objBeta_ = V(0);
+    for (auto &c : objCoef_) c = V(0);
+  }
+
+  // Adds c * var to the objective, written in terms of the nonbasic variables
+  void addObjective(unsigned var, const V &c) {
+    if (rowOf_[var] >= 0) {
+      unsigned r = rowOf_[var];
+      objBeta_ = objBeta_ + c * beta_[r];
+      for (unsigned k = 0; k < cols_; k++) {
+        if (coef_[r][k] != T(0)) objCoef_[k] = objCoef_[k] + c * coef_[r][k];
+      }
+    } else {
+      unsigned k = colOf_[var];
+      objCoef_[k] = objCoef_[k] + c;
+    }
+  }
+
+  void setObjective(unsigned var) {
+    clearObjective();
+    addObjective(var, V(1));
+  }
+
+  /**
+   * Minimizes the objective with Bland's rule.
+   *
+   * If relaxed is a variable, its nonnegativity is ignored, and the search
+   * stops with Violated as soon as it is known that it can become negative
+   * while every other constraint holds. No pivot ever makes it negative, so
+   * the basis stays feasible for the full system.
+   */
+  Outcome optimize(int relaxed = -1) {
+    while (true) {
+      int enter = -1, dir = 0;
+      for (unsigned k = 0; k < cols_; k++) {
+        if (deadCol_[k] || objCoef_[k] == T(0)) continue;
+        unsigned var = nonbasic_[k];
+        bool free = isFree(var) || int(var) == relaxed;
+        int d;
+        if (objCoef_[k] < T(0))
+          d = 1;
+        else if (free)
+          d = -1;
+        else
+          continue;
+        if (enter < 0 || var < nonbasic_[enter]) {
+          enter = k;
+          dir = d;
+        }
+      }
+      if (enter < 0) return Optimal;
+
+      V step;
+      int leave = ratioTest(enter, dir, relaxed, step);
+      if (relaxed >= 0) {
+        if (int(nonbasic_[enter]) == relaxed) {
+          // The relaxed variable itself decreases from zero
+          if (leave < 0 || step > T(0)) return Violated;
+        } else if (rowOf_[relaxed] >= 0) {
+          unsigned r = rowOf_[relaxed];
+          V d = coef_[r][enter];
+          if (dir < 0) d = -d;
+          if (d < T(0)) {
+            V t = beta_[r] / (-d);
+            if (leave < 0 || t < step) return Violated;
+          }
+        }
+      }
+      if (leave < 0) {
+        rayCol_ = enter;
+        rayDir_ = dir;
+        return Unbounded;
+      }
+      pivot(leave, enter);
+    }
+  }
+
+  // Maximizes the basic variable of row r with Bland's rule, and pivots it
+  // out of the basis as soon as it can reach zero while every other row
+  // stays feasible. Returns false if its maximum is negative.
+  bool restore(unsigned r) {
+    while (beta_[r] < T(0)) {
+      int enter = -1, dir = 0;
+      for (unsigned k = 0; k < cols_; k++) {
+        if (deadCol_[k] || coef_[r][k] == T(0)) continue;
+        unsigned var = nonbasic_[k];
+        int d = coef_[r][k] > T(0) ? 1 : -1;
+        if (d < 0 && !isFree(var)) continue;
+        if (enter < 0 || var < nonbasic_[enter]) {
+          enter = k;
+          dir = d;
+        }
+      }
+      if (enter < 0) return false;
+      V step;
+      int leave = ratioTest(enter, dir, int(basic_[r]), step);
+      V rate = coef_[r][enter];
+      if (dir < 0) rate = -rate;
+      if (leave < 0 || !(step < -beta_[r] / rate)) {
+        pivot(r, enter);
+        return true;
+      }
+      pivot(leave, enter);
+    }
+    return true;
+  }
+
+  // Chvatal's auxiliary problem: subtract an auxiliary variable from every
+  // constraint, make it basic in the most violated row and minimize it
+  bool phase1() {
+    int worst = -1;
+    for (unsigned r = 0; r < m_; r++) {
+      if (!constrained(r) || beta_[r] >= T(0)) continue;
+      if (worst < 0 || beta_[r] < beta_[worst]) worst = r;
+    }
+    if (worst < 0) return true;
+
+    unsigned k = colOf_[aux()];
+    deadCol_[k] = false;
+    for (unsigned r = 0; r < m_; r++) {
+      if (constrained(r)) coef_[r][k] = V(1);
+    }
+    pivot(worst, k);
+    setObjective(aux());
+    optimize();
+    bool feasible = objBeta_ == T(0);
+
+    // Drive the auxiliary variable out of the basis and drop its column
+    if (rowOf_[aux()] >= 0) {
+      unsigned r = rowOf_[aux()];
+      for (unsigned j = 0; j < cols_; j++) {
+        if (coef_[r][j] != T(0)) {
+          pivot(r, j);
+          break;
+        }
+      }
+      if (rowOf_[aux()] >= 0) killRow(r);
+    }
+    if (colOf_[aux()] >= 0) {
+      unsigned c = colOf_[aux()];
+      for (unsigned r = 0; r < m_; r++) coef_[r][c] = V(0);
+      deadCol_[c] = true;
+    }
+    clearObjective();
+    return feasible;
+  }
+};
+
+}  // namespace fm
+
+#endif  // UTVPI_OA_SIMPLEX_H
@@ -0,0 +1,246 @@
+#if !defined(UTVPI_OA_STATS_H)
+#define UTVPI_OA_STATS_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace fm {
+
+/**
+ * Counters and timers of the hot paths
+ *
+ * They are compiled in with UTVPI_OA_WITH_STATS, and otherwise every call
+ * below is empty. Each thread counts in a block of its own, which no other
+ * thread writes, so a count is a relaxed load and store. statsSnapshot()
+ * sums the blocks of the running threads and of those which have exited.
+ */
+enum class Counter : unsigned {
+  Eliminations,      // removeVar calls
+  Combinations,      // (positive, negative) row pairs met by removeVar
+  ChernikovDrops,    // pairs dropped by the Chernikov criterion
+  ImbertDrops,       // combinations dropped by Imbert or as all zeros
+  RowsKept,          // rows of the removeVar results
+  RedundancyChecks,  // LP checks of removeRedundantConstraints
+  RedundantRows,     // rows dropped by them
+  DuplicateRows,     // rows dropped before them as repeats of another row
+  LPSolves,          // directions minimized by LP0
+  SeededDirections,  // directions LP0 took from the octagon seeds
+  LPSystems,         // systems LP0 ran on
+  LPLoads,           // loads of an LP backend with one of them
+  BudgetFallbacks,   // pairs bounded by LP0 after FM ran over its budget
+  RoundedRows,       // rows whose constant the float engine rounded down
+  FloatFallbacks,    // systems the float engine left to exact FM2
+  Gcd,               // gcd calls of Rational
+  Lcm,               // lcm calls of Rational
+  Count
+};
+
+// The recursions of FM1
+enum class Phase : unsigned { FindOA_f, FindOA_g, FindOA_h, Count };
+
+constexpr unsigned kStatsCounters = unsigned(Counter::Count);
+constexpr unsigned kStatsPhases = unsigned(Phase::Count);
+// The level of a recursion is the number of variables eliminated so far.
+// Deeper levels are all counted in the last one.
+constexpr unsigned kStatsLevels = 64;
+
+#if defined(UTVPI_OA_WITH_STATS)
+constexpr bool kStatsEnabled = true;
+#else
+constexpr bool kStatsEnabled = false;
+#endif
+
+struct Stats {
+  uint64_t counters[kStatsCounters] = {};
+  // Largest removeVar result, before any redundancy pass
+  uint64_t peakRows = 0;
+  // Calls and time of findOA_f/g/h per level. The time of a call includes
+  // that of the calls below it.
+  uint64_t calls[kStatsPhases][kStatsLevels] = {};
+  uint64_t nanos[kStatsPhases][kStatsLevels] = {};
+
+  uint64_t operator[](Counter c) const { return counters[unsigned(c)]; }
+
+  void writeJson(std::ostream &out) const {
+    static const char *const counterNames[kStatsCounters] = {
+        "eliminations",    "combinations",   "chernikov_drops",
+        "imbert_drops",    "rows_kept",      "redundancy_checks",
+        "redundant_rows",  "duplicate_rows", "lp_solves",
+        "seeded_directions", "lp_systems",   "lp_loads",
+        "budget_fallbacks", "rounded_rows",  "float_fallbacks",
+        "gcd",             "lcm"};
+    static const char *const phaseNames[kStatsPhases] = {
+        "findOA_f", "findOA_g", "findOA_h"};
+    out << "{\"enabled\": " << (kStatsEnabled ? "true" : "false");
+    for (unsigned c = 0; c < kStatsCounters; c++) {
+      out << ", \"" << counterNames[c] << "\": " << counters[c];
+    }
+    out << ", \"peak_rows\": " << peakRows << ", \"levels\": [";
+    const char *sep = "";
+    for (unsigned p = 0; p < kStatsPhases; p++) {
+      for (unsigned l = 0; l < kStatsLevels; l++) {
+        if (calls[p][l] == 0) continue;
+        out << sep << "{\"function\": \"" << phaseNames[p]
+            << "\", \"level\": " << l << ", \"calls\": " << calls[p][l]
+            << ", \"seconds\": " << nanos[p][l] * 1e-9 << "}";
+        sep = ", ";
+      }
+    }
+    out << "]}";
+  }
+};
+
+namespace detail {
+
+// Counts of one thread, only written by it
+struct StatsBlock {
+  std::atomic<uint64_t> counters[kStatsCounters] = {};
+  std::atomic<uint64_t> peakRows{0};
+  std::atomic<uint64_t> calls[kStatsPhases][kStatsLevels] = {};
+  std::atomic<uint64_t> nanos[kStatsPhases][kStatsLevels] = {};
+
+  static void bump(std::atomic<uint64_t> &v, uint64_t n) {
+    v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+  void addTo(Stats &s) const {
+    auto get = [](const std::atomic<uint64_t> &v) {
+      return v.load(std::memory_order_relaxed);
+    };
+    for (unsigned c = 0; c < kStatsCounters; c++) {
+      s.counters[c] += get(counters[c]);
+    }
+    s.peakRows = std::max(s.peakRows, get(peakRows));
+    for (unsigned p = 0; p < kStatsPhases; p++) {
+      for (unsigned l = 0; l < kStatsLevels; l++) {
+        s.calls[p][l] += get(calls[p][l]);
+        s.nanos[p][l] += get(nanos[p][l]);
+      }
+    }
+  }
+
+  void clear() {
+    for (auto &v : counters) v.store(0, std::memory_order_relaxed);
+    peakRows.store(0, std::memory_order_relaxed);
+    for (unsigned p = 0; p < kStatsPhases; p++) {
+      for (unsigned l = 0; l < kStatsLevels; l++) {
+        calls[p][l].store(0, std::memory_order_relaxed);
+        nanos[p][l].store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+};
+
+// Blocks of the running threads, and the sum of those of the threads which
+// have exited
+struct StatsRegistry {
+  std::mutex mutex;
+  std::vector<StatsBlock *> live;
+  Stats retired;
+};
+
+inline StatsRegistry &statsRegistry() {
+  static StatsRegistry registry;
+  return registry;
+}
+
+struct ThreadStats {
+  StatsBlock block;
+
+  ThreadStats() {
+    StatsRegistry &r = statsRegistry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.live.push_back(&block);
+  }
+
+  ~ThreadStats() {
+    StatsRegistry &r = statsRegistry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    block.addTo(r.retired);
+    r.live.erase(std::find(r.live.begin(), r.live.end(), &block));
+  }
+};
+
+inline StatsBlock &threadStats() {
+  thread_local ThreadStats stats;
+  return stats.block;
+}
+
+}  // namespace detail
+
+inline void addStat(Counter c, uint64_t n = 1) {
+  if (kStatsEnabled) {
+    detail::StatsBlock::bump(detail::threadStats().counters[unsigned(c)], n);
+  }
+}
+
+inline void notePeakRows(uint64_t rows) {
+  if (kStatsEnabled) {
+    std::atomic<uint64_t> &peak = detail::threadStats().peakRows;
+    if (rows > peak.load(std::memory_order_relaxed)) {
+      peak.store(rows, std::memory_order_relaxed);
+    }
+  }
+}
+
+// Counts a call of an FM1 recursion and its time, until the end of the scope
+class PhaseTimer {
+ public:
+  PhaseTimer(Phase phase, unsigned level) {
+    if (kStatsEnabled) {
+      phase_ = unsigned(phase);
+      level_ = std::min(level, kStatsLevels - 1);
+      start_ = std::chrono::steady_clock::now();
+    }
+  }
+
+  ~PhaseTimer() {
+    if (kStatsEnabled) {
+      auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start_)
+                    .count();
+      detail::StatsBlock &b = detail::threadStats();
+      detail::StatsBlock::bump(b.calls[phase_][level_], 1);
+      detail::StatsBlock::bump(b.nanos[phase_][level_], ns);
+    }
+  }
+
+  PhaseTimer(const PhaseTimer &) = delete;
+  PhaseTimer &operator=(const PhaseTimer &) = delete;
+
+ private:
+  unsigned phase_ = 0, level_ = 0;
+  std::chrono::steady_clock::time_point start_;
+};
+
+// Counts of all the threads so far
+inline Stats statsSnapshot() {
+  Stats s;
+  if (kStatsEnabled) {
+    detail::StatsRegistry &r = detail::statsRegistry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    s = r.retired;
+    for (detail::StatsBlock *b : r.live) b->addTo(s);
+  }
+  return s;
+}
+
+// Starts counting again from zero. Counts made meanwhile by other threads
+// may be lost, so this is meant for when the library is idle.
+inline void resetStats() {
+  if (kStatsEnabled) {
+    detail::StatsRegistry &r = detail::statsRegistry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.retired = Stats();
+    for (detail::StatsBlock *b : r.live) b->clear();
+  }
+}
+
+}  // namespace fm
+
+#endif  // UTVPI_OA_STATS_H
@@ -0,0 +1,210 @@
+#if !defined(UTVPI_OA_THREAD_POOL_H)
+#define UTVPI_OA_THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fm {
+
+/**
+ * Work-stealing thread pool
+ *
+ * Every worker owns a deque of tasks. It pushes and pops at the back of its
+ * own deque and, when that is empty, steals from the front of the others, so
+ * nested tasks stay on the thread that spawned them until some other thread
+ * runs out of work. A pool of size n runs n - 1 background threads; worker 0
+ * is the thread driving the pool, which executes tasks while it waits for a
+ * TaskGroup.
+ */
+class ThreadPool {
+ public:
+  explicit ThreadPool(unsigned nThreads = 1)
+      : queues_(std::max(1u, nThreads)) {
+    for (auto &q : queues_) q.reset(new Queue());
+    for (unsigned w = 1; w < queues_.size(); w++) {
+      threads_.emplace_back([this, w] { workerLoop(w); });
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex_);
+      stop_ = true;
+    }
+    sleepCv_.notify_all();
+    for (auto &t : threads_) t.join();
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  unsigned size() const { return queues_.size(); }
+
+  // Index of the calling thread in [0, size()), 0 for any thread which is
+  // not one of the background workers
+  unsigned currentWorker() const {
+    return current().pool == this ? current().index : 0;
+  }
+
+  void submit(std::function<void()> task) {
+    Queue &q = *queues_[currentWorker()];
+    {
+      std::lock_guard<std::mutex> lock(q.mutex);
+      q.tasks.push_back(std::move(task));
+      queued_++;
+    }
+    {
+      // Pairs with the predicate check of a worker going to sleep
+      std::lock_guard<std::mutex> lock(sleepMutex_);
+    }
+    sleepCv_.notify_one();
+  }
+
+  // Runs one pending task on the calling thread, returns false if there was
+  // none
+  bool runOne() {
+    std::function<void()> task;
+    if (!take(currentWorker(), task)) return false;
+    task();
+    return true;
+  }
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  struct Current {
+    const ThreadPool *pool = nullptr;
+    unsigned index = 0;
+  };
+
+  static Current &current() {
+    static thread_local Current c;
+    return c;
+  }
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> threads_;
+  std::atomic<size_t> queued_{0};
+  std::mutex sleepMutex_;
+  std::condition_variable sleepCv_;
+  bool stop_ = false;
+
+  bool take(unsigned w, std::function<void()> &task) {
+    if (queued_ == 0) return false;
+    {
+      Queue &own = *queues_[w];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (!own.tasks.empty()) {
+        task = std::move(own.tasks.back());
+        own.tasks.pop_back();
+        queued_--;
+        return true;
+      }
+    }
+    for (unsigned k = 1; k < queues_.size(); k++) {
+      Queue &victim = *queues_[(w + k) % queues_.size()];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.tasks.empty()) {
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        queued_--;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void workerLoop(unsigned w) {
+    current().pool = this;
+    current().index = w;
+    std::function<void()> task;
+    while (true) {
+      if (take(w, task)) {
+        task();
+        task = nullptr;
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(sleepMutex_);
+      sleepCv_.wait(lock, [this] { return stop_ || queued_ > 0; });
+      if (stop_) return;
+    }
+  }
+};
+
+/**
+ * Set of tasks submitted to a pool that can be waited for together. The
+ * waiting thread helps running tasks, so groups can be nested. The first
+ * exception thrown by a task is rethrown by wait().
+ */
+class TaskGroup {
+ public:
+  explicit TaskGroup(ThreadPool &pool) : pool_(pool) {}
+
+  ~TaskGroup() {
+    while (pending_ > 0) help();
+  }
+
+  template <class F>
+  void run(F f) {
+    pending_++;
+    pool_.submit([this, f] {
+      try {
+        f();
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(errorMutex_);
+        if (!error_) error_ = std::current_exception();
+      }
+      pending_--;
+    });
+  }
+
+  void wait() {
+    while (pending_ > 0) help();
+    if (error_) {
+      std::exception_ptr e = error_;
+      error_ = nullptr;
+      std::rethrow_exception(e);
+    }
+  }
+
+ private:
+  ThreadPool &pool_;
+  std::atomic<unsigned> pending_{0};
+  std::mutex errorMutex_;
+  std::exception_ptr error_;
+
+  void help() {
+    if (!pool_.runOne()) std::this_thread::yield();
+  }
+};
+
+/**
+ * Runs f(i) for every i in [0, n) on the pool, in chunks of grain consecutive
+ * indices, and returns once all of them are done
+ */
+template <class F>
+void parallelFor(ThreadPool &pool, unsigned n, unsigned grain, F f) {
+  TaskGroup group(pool);
+  for (unsigned begin = 0; begin < n; begin += grain) {
+    unsigned end = std::min(n, begin + grain);
+    group.run([begin, end, &f] {
+      for (unsigned i = begin; i < end; i++) f(i);
+    });
+  }
+  group.wait();
+}
+
+}  // namespace fm
+
+#endif  // UTVPI_OA_THREAD_POOL_H
@@ -1,13 +1,87 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #include <piplib/piplib64.h>
 
-int main() {
+/* Objective direction x_i, or x_i + sign * x_j for a pair (j >= 0) */
+struct direction {
+  int i, j, sign;
+};
 
-  PipMatrix * domain, * input_domain;
+/* Minimum and maximum of one direction, as written by the worker solving it */
+struct bounds {
+  int minFound, maxFound;
+  long long min, max;
+};
+
+static int solve(PipMatrix * domain, PipOptions * options, int maximize,
+                 long long * value) {
   PipQuast * solution;
+  int found = 0;
+
+  options->Maximize = maximize;
+  solution = pip_solve(domain, NULL, -1, options);
+  if (solution != NULL) {
+    if (solution->list != NULL) {
+      *value = solution->list->vector->the_vector[0];
+      found = 1;
+    }
+  }
+  pip_quast_free(solution);
+  return found;
+}
+
+/*
+ * Solves directions until none is left. The next unsolved direction is taken
+ * from a counter shared by all the workers, so a worker which is done with
+ * cheap directions picks up the remaining ones.
+ */
+static void work(PipMatrix * domain, PipOptions * options,
+                 const struct direction * dirs, int nDirs,
+                 struct bounds * results, int * next) {
+  long long * v = domain->p[domain->NbRows-1];
+  int d;
+
+  while ((d = __atomic_fetch_add(next, 1, __ATOMIC_RELAXED)) < nDirs) {
+    const struct direction * dir = &dirs[d];
+    v[dir->i+2] = -1;
+    if (dir->j >= 0) {
+      v[dir->j+2] = -dir->sign;
+    }
+    results[d].minFound = solve(domain, options, 0, &results[d].min);
+    results[d].maxFound = solve(domain, options, 1, &results[d].max);
+    v[dir->i+2] = 0;
+    if (dir->j >= 0) {
+      v[dir->j+2] = 0;
+    }
+  }
+}
+
+int main(int argc, char * argv[]) {
+
+  PipMatrix * domain, * input_domain;
   PipOptions * options;
-  PipList * l;
+  struct direction * dirs;
+  struct bounds * results;
+  int * next;
   long long * v;
+  int nWorkers = 1, nVars, nDirs, d, failed = 0;
+  size_t shared;
+
+  for (int i=1; i<argc; i++) {
+    if (strcmp(argv[i], "-j") == 0 && i+1 < argc) {
+      nWorkers = atoi(argv[++i]);
+      if (nWorkers <= 0) {
+        nWorkers = sysconf(_SC_NPROCESSORS_ONLN);
+      }
+    } else {
+      fprintf(stderr, "Usage: %s [-j N]\n", argv[0]);
+      return 1;
+    }
+  }
 
   options = pip_options_init();
   options->Verbose = 1;
@@ -36,93 +110,90 @@ int main() {
   v[0] = 0;
   v[1] = 1;
 
-  for (int i=2; i<domain->NbColumns-1; i++) {
-    v[i] = -1;
-
-    options->Maximize = 0;
-    solution = pip_solve(domain, NULL, -1, options);
-    if (solution != NULL) {
-      if (solution->list != NULL || solution->condition != NULL) {
-        l = solution->list;
-        printf("%lld", l->vector->the_vector[0]);
-      }
-    }
-    pip_quast_free(solution);
-
-    printf(" <= x_%d <= ", i-2);
-
-    options->Maximize = 1;
-    solution = pip_solve(domain, NULL, -1, options);
-    if (solution != NULL) {
-      if (solution->list != NULL || solution->condition != NULL) {
-        l = solution->list;
-        printf("%lld", l->vector->the_vector[0]);
-      }
+  /* Unary directions first, then x_i - x_j and x_i + x_j for every pair */
+  nVars = domain->NbColumns - 3;
+  nDirs = nVars + nVars * (nVars - 1);
+  dirs = malloc(nDirs * sizeof(struct direction));
+  d = 0;
+  for (int i=0; i<nVars; i++) {
+    dirs[d].i = i;
+    dirs[d].j = -1;
+    dirs[d++].sign = 0;
+  }
+  for (int i=0; i<nVars; i++) {
+    for (int j=i+1; j<nVars; j++) {
+      dirs[d].i = i;
+      dirs[d].j = j;
+      dirs[d++].sign = -1;
+      dirs[d].i = i;
+      dirs[d].j = j;
+      dirs[d++].sign = 1;
     }
-    pip_quast_free(solution);
-
-    printf("\n");
-    v[i] = 0;
   }
 
-  for (int i=2; i<domain->NbColumns-1; i++) {
-    for (int j=i+1; j<domain->NbColumns-1; j++) {
-      v[i] = -1;
-      v[j] = 1;
-
-      options->Maximize = 0;
-      solution = pip_solve(domain, NULL, -1, options);
-      if (solution != NULL) {
-        if (solution->list != NULL || solution->condition != NULL) {
-          l = solution->list;
-          printf("%lld", l->vector->the_vector[0]);
-        }
-      }
-      pip_quast_free(solution);
-
-      printf(" <= x_%d - x_%d <= ", i-2, j-2);
-
-      options->Maximize = 1;
-      solution = pip_solve(domain, NULL, -1, options);
-      if (solution != NULL) {
-        if (solution->list != NULL || solution->condition != NULL) {
-          l = solution->list;
-          printf("%lld", l->vector->the_vector[0]);
-        }
+  /*
+   * PIPLib keeps global state, so the workers are forked processes, each with
+   * its own copy of the domain. They write the bounds of every direction to
+   * its own slot of a shared mapping, which is printed in direction order
+   * once all of them are done.
+   */
+  shared = sizeof(int) + nDirs * sizeof(struct bounds);
+  next = mmap(NULL, shared, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+              -1, 0);
+  if (next == MAP_FAILED) {
+    perror("mmap");
+    return 1;
+  }
+  results = (struct bounds *) (next + 1);
+  *next = 0;
+
+  if (nWorkers <= 1) {
+    work(domain, options, dirs, nDirs, results, next);
+  } else {
+    fflush(stdout);
+    fflush(stderr);
+    for (int w=0; w<nWorkers; w++) {
+      pid_t pid = fork();
+      if (pid < 0) {
+        perror("fork");
+        failed = 1;
+        break;
       }
-      pip_quast_free(solution);
-
-      printf("\n");
-      v[j] = -1;
-
-      options->Maximize = 0;
-      solution = pip_solve(domain, NULL, -1, options);
-      if (solution != NULL) {
-        if (solution->list != NULL || solution->condition != NULL) {
-          l = solution->list;
-          printf("%lld", l->vector->the_vector[0]);
-        }
+      if (pid == 0) {
+        work(domain, options, dirs, nDirs, results, next);
+        _exit(0);
       }
-      pip_quast_free(solution);
-
-      printf(" <= x_%d + x_%d <= ", i-2, j-2);
-
-      options->Maximize = 1;
-      solution = pip_solve(domain, NULL, -1, options);
-      if (solution != NULL) {
-        if (solution->list != NULL || solution->condition != NULL) {
-          l = solution->list;
-          printf("%lld", l->vector->the_vector[0]);
-        }
+    }
+    int status;
+    while (wait(&status) > 0) {
+      if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        failed = 1;
       }
-      pip_quast_free(solution);
+    }
+    if (failed || *next < nDirs) {
+      fprintf(stderr, "A worker failed\n");
+      return 1;
+    }
+  }
 
-      printf("\n");
-      v[i] = 0;
-      v[j] = 0;
+  for (d=0; d<nDirs; d++) {
+    if (results[d].minFound) {
+      printf("%lld", results[d].min);
+    }
+    if (dirs[d].j < 0) {
+      printf(" <= x_%d <= ", dirs[d].i);
+    } else {
+      printf(" <= x_%d %c x_%d <= ", dirs[d].i, dirs[d].sign < 0 ? '-' : '+',
+             dirs[d].j);
     }
+    if (results[d].maxFound) {
+      printf("%lld", results[d].max);
+    }
+    printf("\n");
   }
 
+  munmap(next, shared);
+  free(dirs);
   pip_options_free(options);
   pip_matrix_free(domain);
 
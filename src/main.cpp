@@ -1,15 +1,250 @@
+#include <utvpi_oa_float.h>
 #include <utvpi_oa_fm.h>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
 #include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
 
-int main() {
-  fm::System<int> system;
-  system.read(std::cin);
-  system.print(std::cout);
-  system.removeRedundantConstraints();
-  system.print(std::cout);
-  std::cout << "Over Approximation using LP" << std::endl;
-  system.printLPOA(std::cout);
-  std::cout << "Over Approximation using FM" << std::endl;
-  system.printFMOA(std::cout);
+using System = fm::System<fm::Integer>;
+
+static void usage(const char *name) {
+  std::cerr << "Usage: " << name << " [-j N] [--fm=1|2|float] [--fm-tighten]"
+            << " [--order=greedy|index]" << std::endl
+            << "       [--lp=simplex"
+#if defined(UTVPI_OA_WITH_CPLEX)
+            << "|cplex"
+#endif
+            << "] [--batch[=N]]" << std::endl
+            << "       [--format=fmlib|cdd|binary] [--to-binary] [--stats=json]"
+            << " [--output=rows|octagon|dbm]" << std::endl
+            << "       [--budget=S] [--budget-rows=N] [--budget-mb=M]"
+            << std::endl;
+  std::cerr << "  -j N         number of threads, 0 for one per core"
+            << " (default 1)" << std::endl;
+  std::cerr << "  --fm=float   FM2 in doubles, with the constants rounded down"
+            << " so that the" << std::endl
+            << "               bounds stay sound" << std::endl;
+  std::cerr << "  --fm-tighten minimize the bounds of --fm=float which came"
+            << " from rounded" << std::endl
+            << "               rows again with the exact simplex" << std::endl;
+  std::cerr << "  --batch[=N]  read systems until the end of the input, with up"
+            << " to N of them" << std::endl
+            << "               in flight (default 1)" << std::endl;
+  std::cerr << "  --format=F   input format (default fmlib)" << std::endl;
+  std::cerr << "  --to-binary  write the input systems in the binary format"
+            << " instead" << std::endl;
+  std::cerr << "  --stats=json write the counters of the run to the standard"
+            << " error" << std::endl;
+  std::cerr << "  --output=O   print the over-approximations as found (rows),"
+            << " as the rows" << std::endl
+            << "               of their closed octagon (octagon) or as its"
+            << " matrix (dbm)" << std::endl;
+  std::cerr << "  --budget=S, --budget-rows=N, --budget-mb=M" << std::endl
+            << "               limit FM to S seconds and to N rows and M MiB"
+            << " per intermediate" << std::endl
+            << "               system, the pairs of a branch over the limits"
+            << " are bounded with LP0" << std::endl;
+}
+
+enum class Format { FMLib, Cdd, Binary };
+
+// Systems of the input, one after the other
+class Input {
+ public:
+  Input(int fd, Format format)
+      : buffer_(fd), pos_(buffer_.begin()), format_(format) {}
+
+  // Reads the next system, returns false at the end of the input or on a
+  // malformed system
+  bool next(System &system) {
+    if (format_ == Format::Binary) {
+      if (pos_ == buffer_.end()) return false;
+      error_ = !system.readBinary(pos_, buffer_.end());
+      return !error_;
+    }
+    fm::TextScanner text(pos_, buffer_.end());
+    if (text.atEnd()) return false;
+    error_ = !(format_ == Format::Cdd ? system.readCdd(text)
+                                      : system.read(text));
+    pos_ = text.position();
+    return !error_;
+  }
+
+  bool failed() const { return error_; }
+
+ private:
+  fm::InputBuffer buffer_;
+  const char *pos_;
+  Format format_;
+  bool error_ = false;
+};
+
+struct Options {
+  fm::LPFactory<fm::Integer> lpFactory =
+      fm::solverFactory<fm::Integer, fm::SimplexSolver>();
+  bool fm2 = false;
+  bool floatFM = false, tighten = false;
+  System::EliminationCost order = System::duffinCost;
+  fm::OAFormat output = fm::OAFormat::Rows;
+  fm::Budget budget;
+};
+
+// The idle LP backends are shared by all the systems of a run
+static void run(System &system, std::ostream &out, fm::ThreadPool &pool,
+                fm::LPBackends<fm::Integer> &backends,
+                const Options &options) {
+  system.print(out);
+  system.removeRedundantConstraints(pool);
+  system.print(out);
+  out << "Over Approximation using LP" << std::endl;
+  system.printLPOA(out, backends, pool, options.output);
+  out << "Over Approximation using FM" << std::endl;
+  if (options.floatFM) {
+    fm::printFloatFMOA(system, out, pool, options.tighten, options.output,
+                       options.budget);
+    return;
+  }
+  fm::ProjectionCache<System> cache(System::kProjectionCacheBytes);
+  system.printFMOA(out, pool, cache, options.fm2, options.order,
+                   options.output, options.budget);
+}
+
+// A system of the batch, whose output is kept until all the systems before
+// it have been written
+struct Instance {
+  System system;
+  std::ostringstream out;
+  std::atomic<bool> done{false};
+};
+
+// Solves the systems of the input in order, up to inFlight of them at once
+// on the pool. Every output is written, followed by an empty line, as soon
+// as it and those of all the systems before it are done.
+static void runBatch(Input &input, fm::ThreadPool &pool,
+                     fm::LPBackends<fm::Integer> &backends,
+                     const Options &options, unsigned inFlight) {
+  std::deque<std::shared_ptr<Instance>> pending;
+  fm::TaskGroup group(pool);
+  auto flush = [&](bool wait) {
+    while (!pending.empty()) {
+      Instance &front = *pending.front();
+      if (!front.done) {
+        if (!wait) return;
+        if (!pool.runOne()) std::this_thread::yield();
+        continue;
+      }
+      std::cout << front.out.str() << std::endl;
+      pending.pop_front();
+      wait = false;
+    }
+  };
+  while (true) {
+    auto instance = std::make_shared<Instance>();
+    if (!input.next(instance->system)) break;
+    pending.push_back(instance);
+    group.run([instance, &pool, &backends, &options] {
+      try {
+        run(instance->system, instance->out, pool, backends, options);
+      } catch (const std::exception &e) {
+        instance->out << "Error: " << e.what() << std::endl;
+      }
+      instance->done = true;
+    });
+    flush(pending.size() >= inFlight);
+  }
+  while (!pending.empty()) flush(true);
+  group.wait();
+}
+
+int main(int argc, char **argv) {
+  Options options;
+  unsigned nThreads = 1, inFlight = 0;
+  Format format = Format::FMLib;
+  bool toBinary = false, stats = false;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--lp=simplex") == 0) {
+      options.lpFactory = fm::solverFactory<fm::Integer, fm::SimplexSolver>();
+#if defined(UTVPI_OA_WITH_CPLEX)
+    } else if (std::strcmp(argv[i], "--lp=cplex") == 0) {
+      options.lpFactory = fm::solverFactory<fm::Integer, fm::CplexSolver>();
+#endif
+    } else if (std::strcmp(argv[i], "--fm=1") == 0) {
+      options.fm2 = options.floatFM = false;
+    } else if (std::strcmp(argv[i], "--fm=2") == 0) {
+      options.fm2 = true;
+      options.floatFM = false;
+    } else if (std::strcmp(argv[i], "--fm=float") == 0) {
+      options.floatFM = true;
+    } else if (std::strcmp(argv[i], "--fm-tighten") == 0) {
+      options.tighten = true;
+    } else if (std::strcmp(argv[i], "--order=greedy") == 0) {
+      options.order = System::duffinCost;
+    } else if (std::strcmp(argv[i], "--order=index") == 0) {
+      options.order = System::indexCost;
+    } else if (std::strcmp(argv[i], "--batch") == 0) {
+      inFlight = 1;
+    } else if (std::strncmp(argv[i], "--batch=", 8) == 0) {
+      inFlight = std::max(1ul, std::strtoul(argv[i] + 8, nullptr, 10));
+    } else if (std::strcmp(argv[i], "--format=fmlib") == 0) {
+      format = Format::FMLib;
+    } else if (std::strcmp(argv[i], "--format=cdd") == 0) {
+      format = Format::Cdd;
+    } else if (std::strcmp(argv[i], "--format=binary") == 0) {
+      format = Format::Binary;
+    } else if (std::strcmp(argv[i], "--to-binary") == 0) {
+      toBinary = true;
+    } else if (std::strcmp(argv[i], "--output=rows") == 0) {
+      options.output = fm::OAFormat::Rows;
+    } else if (std::strcmp(argv[i], "--output=octagon") == 0) {
+      options.output = fm::OAFormat::Octagon;
+    } else if (std::strcmp(argv[i], "--output=dbm") == 0) {
+      options.output = fm::OAFormat::Matrix;
+    } else if (std::strncmp(argv[i], "--budget=", 9) == 0) {
+      options.budget.seconds = std::strtod(argv[i] + 9, nullptr);
+    } else if (std::strncmp(argv[i], "--budget-rows=", 14) == 0) {
+      options.budget.maxRows = std::strtoul(argv[i] + 14, nullptr, 10);
+    } else if (std::strncmp(argv[i], "--budget-mb=", 12) == 0) {
+      options.budget.maxBytes = std::strtoul(argv[i] + 12, nullptr, 10) << 20;
+    } else if (std::strcmp(argv[i], "--stats=json") == 0) {
+      stats = true;
+    } else if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      nThreads = std::strtoul(argv[++i], nullptr, 10);
+      if (nThreads == 0) nThreads = std::thread::hardware_concurrency();
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  Input input(0, format);
+  if (toBinary) {
+    System system;
+    while (input.next(system)) {
+      if (!system.writeBinary(std::cout)) {
+        std::cerr << "A coefficient does not fit in 64 bits" << std::endl;
+        return 1;
+      }
+    }
+  } else {
+    fm::ThreadPool pool(nThreads);
+    fm::LPBackends<fm::Integer> backends(options.lpFactory);
+    if (inFlight > 0) {
+      runBatch(input, pool, backends, options, inFlight);
+    } else {
+      System system;
+      if (input.next(system)) run(system, std::cout, pool, backends, options);
+    }
+  }
+  if (stats) {
+    fm::statsSnapshot().writeJson(std::cerr);
+    std::cerr << std::endl;
+  }
+  if (input.failed()) {
+    std::cerr << "Malformed system in the input" << std::endl;
+    return 1;
+  }
   return 0;
 }
@@ -0,0 +1,53 @@
+# Runs utvpi-oa on a batch of examples with several systems in flight on
+# several threads. The output must be that of the sequential batch, and
+# every LP0 call may load a backend at most once per thread, i.e. the
+# systems in flight must not reload each other's backends.
+#
+# cmake -DTOOL=<utvpi-oa> -DWORK_DIR=<dir> -DTHREADS=N -DIN_FLIGHT=M
+#       -DINPUTS=<file;...> -P batch_test.cmake
+
+set(batch "${WORK_DIR}/batch_test_input.txt")
+file(WRITE "${batch}" "")
+foreach(input ${INPUTS})
+  file(READ "${input}" text)
+  file(APPEND "${batch}" "${text}")
+endforeach()
+
+execute_process(COMMAND "${TOOL}" --batch
+                INPUT_FILE "${batch}"
+                OUTPUT_VARIABLE expected
+                RESULT_VARIABLE status)
+if(NOT status EQUAL 0)
+  message(FATAL_ERROR "sequential batch failed: ${status}")
+endif()
+
+execute_process(COMMAND "${TOOL}" --batch=${IN_FLIGHT} -j ${THREADS}
+                        --stats=json
+                INPUT_FILE "${batch}"
+                OUTPUT_VARIABLE output
+                ERROR_VARIABLE stats
+                RESULT_VARIABLE status)
+if(NOT status EQUAL 0)
+  message(FATAL_ERROR "parallel batch failed: ${status}")
+endif()
+if(NOT output STREQUAL expected)
+  message(FATAL_ERROR "parallel batch output differs from the sequential one")
+endif()
+
+if(stats MATCHES "\"enabled\": *false")
+  message(STATUS "counters compiled out, reloads not checked")
+  return()
+endif()
+string(REGEX MATCH "\"lp_systems\": *([0-9]+)" _ "${stats}")
+set(systems ${CMAKE_MATCH_1})
+string(REGEX MATCH "\"lp_loads\": *([0-9]+)" _ "${stats}")
+set(loads ${CMAKE_MATCH_1})
+if(systems STREQUAL "" OR loads STREQUAL "")
+  message(FATAL_ERROR "no LP0 counters in: ${stats}")
+endif()
+math(EXPR limit "${systems} * ${THREADS}")
+message(STATUS "${systems} LP0 systems, ${loads} backend loads")
+if(loads GREATER limit)
+  message(FATAL_ERROR
+          "${loads} backend loads for ${systems} systems on ${THREADS} threads")
+endif()
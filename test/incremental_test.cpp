@@ -0,0 +1,94 @@
+// Checks IncrementalOA against LP0: every system given on the command line is
+// grown one row at a time from its first row, and after every row the rows
+// and the octagon of the incremental over-approximation must print as those
+// of findLPOA on the rows added so far.
+
+#include <utvpi_oa_fm.h>
+#include <utvpi_oa_incremental.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using System = fm::System<fm::Integer>;
+
+// The first rows of system, as a system of its own
+static System prefix(const System &system, unsigned rows) {
+  fm::Matrix<fm::Integer> scratch;
+  const fm::Matrix<fm::Integer> &dense = system.denseLines(scratch);
+  System res;
+  res.varLabels = system.varLabels;
+  res.nVars = system.nVars;
+  res.lines.setCols(system.nVars + 1);
+  for (unsigned i = 0; i < rows; i++) res.lines.pushRow(dense[i]);
+  res.nLines = rows;
+  return res;
+}
+
+// Whether the incremental over-approximation is that of LP0 on its rows
+static bool matches(const fm::IncrementalOA<fm::Integer> &oa,
+                    fm::ThreadPool &pool, std::string &error) {
+  System expected;
+  expected.varLabels = oa.system().varLabels;
+  expected.nVars = oa.system().nVars;
+  bool feasible = System::findLPOA(
+      oa.system(), expected,
+      fm::solverFactory<fm::Integer, fm::SimplexSolver>(), pool);
+  if (feasible != oa.feasible()) {
+    error = feasible ? "infeasible, LP0 is not" : "feasible, LP0 is not";
+    return false;
+  }
+  if (!feasible) return true;
+  std::ostringstream rows, lpRows;
+  oa.result().printOA(rows, fm::OAFormat::Rows);
+  expected.printOA(lpRows, fm::OAFormat::Rows);
+  if (rows.str() != lpRows.str()) {
+    error = "rows differ:\n" + rows.str() + "LP0:\n" + lpRows.str();
+    return false;
+  }
+  std::ostringstream octagon, lpOctagon;
+  oa.octagon().print(octagon, oa.system().varLabels);
+  expected.printOA(lpOctagon, fm::OAFormat::Octagon);
+  if (octagon.str() != lpOctagon.str()) {
+    error = "octagons differ:\n" + octagon.str() + "LP0:\n" + lpOctagon.str();
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " FILE..." << std::endl;
+    return 2;
+  }
+  fm::ThreadPool pool(1);
+  int failures = 0;
+  for (int a = 1; a < argc; a++) {
+    std::ifstream in(argv[a]);
+    if (!in) {
+      std::cerr << argv[a] << ": cannot open" << std::endl;
+      return 2;
+    }
+    System system;
+    system.read(in);
+    if (system.rows() == 0) continue;
+    fm::Matrix<fm::Integer> scratch;
+    const fm::Matrix<fm::Integer> &dense = system.denseLines(scratch);
+    fm::IncrementalOA<fm::Integer> oa(prefix(system, 1));
+    std::string error;
+    bool ok = matches(oa, pool, error);
+    unsigned i = 1;
+    for (; ok && oa.feasible() && i < system.rows(); i++) {
+      const fm::Integer *row = dense[i];
+      oa.addConstraint(std::vector<fm::Integer>(row, row + system.nVars + 1));
+      ok = matches(oa, pool, error);
+    }
+    if (!ok) {
+      std::cerr << argv[a] << ": after " << i << " rows, " << error
+                << std::endl;
+      failures++;
+    }
+  }
+  return failures == 0 ? 0 : 1;
+}